@@ -0,0 +1,79 @@
+#include "BatchRunner.hpp"
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+void read_manifest(const std::string& filename, std::vector<BatchJob>& jobs) {
+    std::ifstream manifest(filename);
+    if (!manifest.is_open()) {
+        throw std::runtime_error("Cannot open manifest: " + filename);
+    }
+
+    std::string line;
+    while (std::getline(manifest, line)) {
+        std::istringstream fields(line);
+        std::string input;
+        std::string output;
+        if (!(fields >> input) || input[0] == '#') {
+            continue;
+        }
+        fields >> output;
+        BatchJob job = { parse_input_spec(input), output, false, "" };
+        jobs.push_back(job);
+    }
+    if (manifest.bad()) {
+        throw std::runtime_error("Error reading manifest: " + filename);
+    }
+}
+
+bool prepare_batch(const BatchSettings& settings,
+                   std::vector<BatchJob>& jobs,
+                   std::vector<bool>& runnable) {
+    try {
+        if (!settings.manifest.empty()) {
+            read_manifest(settings.manifest, jobs);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return false;
+    }
+    for (size_t i = 0; i < settings.inputs.size(); ++i) {
+        BatchJob job = { settings.inputs[i], "", false, "" };
+        jobs.push_back(job);
+    }
+    if (jobs.empty()) {
+        std::cerr << "Error: No input file specified.\n";
+        return false;
+    }
+
+    // Outputs default to the input's base name; two jobs must not share one
+    std::set<std::string> outputs;
+    runnable.assign(jobs.size(), true);
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        if (jobs[i].output_file.empty()) {
+            jobs[i].output_file = get_base_filename(jobs[i].input.filename) + "." + settings.extension;
+        }
+        if (!outputs.insert(jobs[i].output_file).second) {
+            jobs[i].error = "Output file is also written by an earlier input: " + jobs[i].output_file;
+            runnable[i] = false;
+        }
+    }
+    return true;
+}
+
+int report_batch(const BatchSettings& settings, const std::vector<BatchJob>& jobs) {
+    size_t failed = 0;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        if (!jobs[i].success) {
+            std::cerr << "Error: " << jobs[i].input.filename << ": " << jobs[i].error << std::endl;
+            ++failed;
+        } else if (settings.verbose) {
+            std::cout << jobs[i].input.filename << " -> " << jobs[i].output_file << std::endl;
+        }
+    }
+    std::cout << "Converted " << (jobs.size() - failed) << " of " << jobs.size()
+              << " files" << std::endl;
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,149 @@
+#ifndef BATCH_RUNNER_HPP
+#define BATCH_RUNNER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "BinaryUtils.hpp"
+#include "InputSpec.hpp"
+#include "MemoryImage.hpp"
+#include "Parallel.hpp"
+
+/**
+ * Batch mode shared by bin2hex and bin2mot: many inputs, one output each
+ */
+
+/**
+ * One batch conversion and its outcome
+ */
+struct BatchJob {
+    InputFile input;
+    std::string output_file;
+    bool success;
+    std::string error;
+};
+
+/**
+ * What a batch run converts, and how every input is prepared
+ */
+struct BatchSettings {
+    std::vector<InputFile> inputs;
+    std::string manifest;
+    std::string extension;
+    uint32_t start_address;         // For inputs without an address of their own
+    unsigned threads;
+    bool verbose;
+    bool skip_fill;
+    uint8_t fill_byte;
+    size_t skip_min_run;
+    bool embed_checksum;
+    bool checksum_range_set;        // Otherwise each input's whole image but the checksum
+    BinaryUtils::ChecksumSpec checksum;
+};
+
+/**
+ * One batch input, mapped and ready to convert
+ */
+struct BatchInput {
+    const uint8_t* data;
+    size_t size;
+    uint32_t address;
+    const MemoryImage* image;       // Non-blank parts with skip_fill, else null
+};
+
+/**
+ * Read "input[@address] [output]" lines from a batch manifest
+ * Blank lines and lines starting with '#' are skipped.
+ * @throws std::runtime_error if the manifest cannot be read
+ */
+void read_manifest(const std::string& filename, std::vector<BatchJob>& jobs);
+
+/**
+ * Collect the jobs from the manifest and inputs and name their outputs
+ * A job whose output an earlier job already writes is not runnable.
+ * @return false (after printing the error) if there is nothing to run
+ */
+bool prepare_batch(const BatchSettings& settings,
+                   std::vector<BatchJob>& jobs,
+                   std::vector<bool>& runnable);
+
+/**
+ * Map one job's input, patch its checksum and drop its fill runs as the
+ * settings say, then hand it to convert
+ * @return false (with job.error set) on failure
+ */
+template <typename Converter, typename Convert>
+bool convert_batch_job(const BatchSettings& settings, Converter& converter,
+                       Convert convert, BatchJob& job) {
+    try {
+        uint32_t address = job.input.address_set ? job.input.address : settings.start_address;
+        MappedFile mapped(job.input.filename, settings.embed_checksum);
+
+        if (settings.embed_checksum && settings.checksum_range_set) {
+            BinaryUtils::embed_checksum(mapped.mutable_data(), mapped.size(), address,
+                                        settings.checksum);
+        } else if (settings.embed_checksum) {
+            BinaryUtils::embed_image_checksum(mapped.mutable_data(), mapped.size(), address,
+                                              settings.checksum);
+        }
+
+        MemoryImage image;
+        BatchInput input = { mapped.data(), mapped.size(), address, nullptr };
+        if (settings.skip_fill) {
+            image.add_view_skip_fill(address, mapped.data(), mapped.size(),
+                                     settings.fill_byte, settings.skip_min_run);
+            input.image = &image;
+        }
+
+        bool success = convert(converter, input, job.output_file);
+        if (!success) {
+            job.error = converter.get_last_error();
+        }
+        return success;
+
+    } catch (const std::exception& e) {
+        job.error = e.what();
+        return false;
+    }
+}
+
+/**
+ * Print every failure (and with verbose, every output) and the totals
+ * @return Process exit code
+ */
+int report_batch(const BatchSettings& settings, const std::vector<BatchJob>& jobs);
+
+/**
+ * Convert every batch input on a pool of workers, each reusing one copy
+ * of prototype; a failed file is reported without stopping the others
+ * @param convert bool(Converter&, const BatchInput&, const std::string& output_file),
+ *                false with the converter's last error set on failure
+ * @return Process exit code
+ */
+template <typename Converter, typename Convert>
+int run_batch(const BatchSettings& settings, const Converter& prototype, Convert convert) {
+    std::vector<BatchJob> jobs;
+    std::vector<bool> runnable;
+    if (!prepare_batch(settings, jobs, runnable)) {
+        return 1;
+    }
+
+    unsigned workers = Parallel::worker_count(jobs.size(), settings.threads);
+    if (settings.verbose) {
+        std::cout << "Batch: " << jobs.size() << " files on " << workers << " workers" << std::endl;
+    }
+
+    std::vector<Converter> converters(workers, prototype);
+    Parallel::run_workers(jobs.size(), workers, [&](size_t index, unsigned worker) {
+        if (runnable[index]) {
+            jobs[index].success = convert_batch_job(settings, converters[worker], convert, jobs[index]);
+        }
+    });
+
+    return report_batch(settings, jobs);
+}
+
+#endif // BATCH_RUNNER_HPP
@@ -1,4 +1,15 @@
 #include "BinaryUtils.hpp"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BINARY_UTILS_X86_SIMD 1
+#include <immintrin.h>
+#endif
 
 namespace BinaryUtils {
 
@@ -38,50 +49,908 @@ const uint8_t reflect_table[256] = {
     0x1F, 0x9F, 0x5F, 0xDF, 0x3F, 0xBF, 0x7F, 0xFF
 };
 
-uint8_t calculate_checksum8(const std::vector<uint8_t>& data) {
+// Pre-computed two-character uppercase hex representation of every byte
+const char hex_table[513] =
+    "000102030405060708090A0B0C0D0E0F"
+    "101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F"
+    "303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F"
+    "505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F"
+    "707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F"
+    "909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAF"
+    "B0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECF"
+    "D0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEF"
+    "F0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+// Pre-computed value of every hex digit character (0xFF if not a digit)
+const uint8_t hex_value_table[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+namespace {
+
+typedef char* (*HexKernel)(const uint8_t*, size_t, char*, uint32_t&);
+typedef uint32_t (*SumKernel)(const uint8_t*, size_t);
+typedef bool (*DecodeKernel)(const char*, size_t, uint8_t*);
+typedef size_t (*ScanKernel)(const uint8_t*, size_t, uint8_t, bool);
+
+char* bytes_to_hex_scalar(const uint8_t* data, size_t size, char* out, uint32_t& sum) {
+    for (size_t i = 0; i < size; ++i) {
+        sum += data[i];
+        out = write_hex_byte(out, data[i]);
+    }
+    return out;
+}
+
+bool hex_to_bytes_scalar(const char* text, size_t size, uint8_t* out) {
+    for (size_t i = 0; i < size; ++i) {
+        uint8_t hi = hex_value_table[static_cast<uint8_t>(text[2 * i])];
+        uint8_t lo = hex_value_table[static_cast<uint8_t>(text[2 * i + 1])];
+        if ((hi | lo) & 0xF0) {
+            return false;
+        }
+        out[i] = static_cast<uint8_t>((hi << 4) | lo);
+    }
+    return true;
+}
+
+uint32_t byte_sum_scalar(const uint8_t* data, size_t size) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < size; ++i) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+// Offset of the first byte that equals value (equal) or differs from it
+// (!equal), or size if there is none
+size_t scan_bytes_scalar(const uint8_t* data, size_t size, uint8_t value, bool equal) {
+    if (equal) {
+        const void* hit = std::memchr(data, value, size);
+        return hit ? static_cast<size_t>(static_cast<const uint8_t*>(hit) - data) : size;
+    }
+
+    // Skip whole words of value, then find the odd byte out
+    const uint64_t pattern = 0x0101010101010101ULL * value;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        if (word != pattern) {
+            break;
+        }
+    }
+    while (i < size && data[i] == value) {
+        ++i;
+    }
+    return i;
+}
+
+#ifdef BINARY_UTILS_X86_SIMD
+
+// Split 16 bytes into nibbles, map them through a 16-entry digit table
+// with PSHUFB and interleave high/low digits back into byte order. The
+// same load feeds PSADBW against zero, which sums the bytes for free.
+__attribute__((target("ssse3")))
+char* bytes_to_hex_ssse3(const uint8_t* data, size_t size, char* out, uint32_t& sum) {
+    const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                         '8', '9', 'A', 'B', 'C', 'D', 'E', 'F');
+    const __m128i low_mask = _mm_set1_epi8(0x0F);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(bytes, zero));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), low_mask);
+        __m128i lo = _mm_and_si128(bytes, low_mask);
+        __m128i hi_chars = _mm_shuffle_epi8(digits, hi);
+        __m128i lo_chars = _mm_shuffle_epi8(digits, lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                         _mm_unpacklo_epi8(hi_chars, lo_chars));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16),
+                         _mm_unpackhi_epi8(hi_chars, lo_chars));
+        out += 32;
+    }
+
+    acc = _mm_add_epi64(acc, _mm_unpackhi_epi64(acc, acc));
+    sum += static_cast<uint32_t>(_mm_cvtsi128_si32(acc));
+    return bytes_to_hex_scalar(data + i, size - i, out, sum);
+}
+
+// Same as the SSSE3 kernel on 32 bytes; unpack works per 128-bit lane,
+// so the lanes are put back in order with a cross-lane permute
+__attribute__((target("avx2")))
+char* bytes_to_hex_avx2(const uint8_t* data, size_t size, char* out, uint32_t& sum) {
+    const __m256i digits = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                            '8', '9', 'A', 'B', 'C', 'D', 'E', 'F',
+                                            '0', '1', '2', '3', '4', '5', '6', '7',
+                                            '8', '9', 'A', 'B', 'C', 'D', 'E', 'F');
+    const __m256i low_mask = _mm256_set1_epi8(0x0F);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = zero;
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(bytes, zero));
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), low_mask);
+        __m256i lo = _mm256_and_si256(bytes, low_mask);
+        __m256i hi_chars = _mm256_shuffle_epi8(digits, hi);
+        __m256i lo_chars = _mm256_shuffle_epi8(digits, lo);
+        __m256i first = _mm256_unpacklo_epi8(hi_chars, lo_chars);
+        __m256i second = _mm256_unpackhi_epi8(hi_chars, lo_chars);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+                            _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 32),
+                            _mm256_permute2x128_si256(first, second, 0x31));
+        out += 64;
+    }
+
+    __m128i acc128 = _mm_add_epi64(_mm256_castsi256_si128(acc),
+                                   _mm256_extracti128_si256(acc, 1));
+    acc128 = _mm_add_epi64(acc128, _mm_unpackhi_epi64(acc128, acc128));
+    sum += static_cast<uint32_t>(_mm_cvtsi128_si32(acc128));
+    return bytes_to_hex_ssse3(data + i, size - i, out, sum);
+}
+
+// Horizontal byte sum: PSADBW against zero adds 8 bytes into each 64-bit lane
+__attribute__((target("sse2")))
+uint32_t byte_sum_sse2(const uint8_t* data, size_t size) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(bytes, zero));
+    }
+
+    acc = _mm_add_epi64(acc, _mm_unpackhi_epi64(acc, acc));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(acc)) +
+           byte_sum_scalar(data + i, size - i);
+}
+
+// Compare 16 bytes against value at once; the lowest set bit of the
+// movemask (inverted when looking for a mismatch) is the byte's offset
+__attribute__((target("sse2")))
+size_t scan_bytes_sse2(const uint8_t* data, size_t size, uint8_t value, bool equal) {
+    const __m128i needle = _mm_set1_epi8(static_cast<char>(value));
+    const unsigned flip = equal ? 0 : 0xFFFF;
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, needle))) ^ flip;
+        if (mask) {
+            return i + static_cast<size_t>(__builtin_ctz(mask));
+        }
+    }
+    return i + scan_bytes_scalar(data + i, size - i, value, equal);
+}
+
+// As above on 64 bytes per iteration, so long fill runs go at load speed
+__attribute__((target("avx2")))
+size_t scan_bytes_avx2(const uint8_t* data, size_t size, uint8_t value, bool equal) {
+    const __m256i needle = _mm256_set1_epi8(static_cast<char>(value));
+    const uint32_t flip = equal ? 0 : 0xFFFFFFFFu;
+
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 32));
+        uint32_t mask_first = static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(first, needle))) ^ flip;
+        uint32_t mask_second = static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(second, needle))) ^ flip;
+        if (mask_first | mask_second) {
+            uint64_t mask = (static_cast<uint64_t>(mask_second) << 32) | mask_first;
+            return i + static_cast<size_t>(__builtin_ctzll(mask));
+        }
+    }
+    return i + scan_bytes_sse2(data + i, size - i, value, equal);
+}
+
+__attribute__((target("avx2")))
+uint32_t byte_sum_avx2(const uint8_t* data, size_t size) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = zero;
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(bytes, zero));
+    }
+
+    __m128i acc128 = _mm_add_epi64(_mm256_castsi256_si128(acc),
+                                   _mm256_extracti128_si256(acc, 1));
+    acc128 = _mm_add_epi64(acc128, _mm_unpackhi_epi64(acc128, acc128));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(acc128)) +
+           byte_sum_sse2(data + i, size - i);
+}
+
+// Map 16 hex characters (either case) to nibble values; invalid characters
+// clear their lane in the returned validity mask
+__attribute__((target("ssse3")))
+inline __m128i hex_to_nibbles_ssse3(__m128i chars, __m128i& valid) {
+    __m128i lower = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+    __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+                                     _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+    __m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                     _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+    valid = _mm_or_si128(is_digit, is_alpha);
+    __m128i digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    __m128i alpha = _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10));
+    return _mm_or_si128(_mm_and_si128(is_digit, digit), _mm_and_si128(is_alpha, alpha));
+}
+
+// 32 characters to 16 bytes: PMADDUBSW computes hi * 16 + lo per pair
+__attribute__((target("ssse3")))
+bool hex_to_bytes_ssse3(const char* text, size_t size, uint8_t* out) {
+    const __m128i weights = _mm_set1_epi16(0x0110);
+    __m128i all_valid = _mm_set1_epi8(-1);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i valid0, valid1;
+        __m128i n0 = hex_to_nibbles_ssse3(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + 2 * i)), valid0);
+        __m128i n1 = hex_to_nibbles_ssse3(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + 2 * i + 16)), valid1);
+        all_valid = _mm_and_si128(all_valid, _mm_and_si128(valid0, valid1));
+        __m128i bytes = _mm_packus_epi16(_mm_maddubs_epi16(n0, weights),
+                                         _mm_maddubs_epi16(n1, weights));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), bytes);
+    }
+
+    if (_mm_movemask_epi8(all_valid) != 0xFFFF) {
+        return false;
+    }
+    return hex_to_bytes_scalar(text + 2 * i, size - i, out + i);
+}
+
+__attribute__((target("avx2")))
+inline __m256i hex_to_nibbles_avx2(__m256i chars, __m256i& valid) {
+    __m256i lower = _mm256_or_si256(chars, _mm256_set1_epi8(0x20));
+    __m256i is_digit = _mm256_andnot_si256(
+        _mm256_cmpgt_epi8(_mm256_set1_epi8('0'), chars),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), chars));
+    __m256i is_alpha = _mm256_andnot_si256(
+        _mm256_cmpgt_epi8(_mm256_set1_epi8('a'), lower),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lower));
+    valid = _mm256_or_si256(is_digit, is_alpha);
+    __m256i digit = _mm256_sub_epi8(chars, _mm256_set1_epi8('0'));
+    __m256i alpha = _mm256_sub_epi8(lower, _mm256_set1_epi8('a' - 10));
+    return _mm256_or_si256(_mm256_and_si256(is_digit, digit),
+                           _mm256_and_si256(is_alpha, alpha));
+}
+
+// 64 characters to 32 bytes; pack works per lane, so fix the qword order
+__attribute__((target("avx2")))
+bool hex_to_bytes_avx2(const char* text, size_t size, uint8_t* out) {
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+    __m256i all_valid = _mm256_set1_epi8(-1);
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i valid0, valid1;
+        __m256i n0 = hex_to_nibbles_avx2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + 2 * i)), valid0);
+        __m256i n1 = hex_to_nibbles_avx2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + 2 * i + 32)), valid1);
+        all_valid = _mm256_and_si256(all_valid, _mm256_and_si256(valid0, valid1));
+        __m256i bytes = _mm256_packus_epi16(_mm256_maddubs_epi16(n0, weights),
+                                            _mm256_maddubs_epi16(n1, weights));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                            _mm256_permute4x64_epi64(bytes, 0xD8));
+    }
+
+    if (_mm256_movemask_epi8(all_valid) != -1) {
+        return false;
+    }
+    return hex_to_bytes_ssse3(text + 2 * i, size - i, out + i);
+}
+
+#endif // BINARY_UTILS_X86_SIMD
+
+struct HexKernelChoice {
+    HexKernel kernel;
+    SumKernel sum;
+    DecodeKernel decode;
+    ScanKernel scan;
+    const char* name;
+};
+
+HexKernelChoice select_hex_kernel() {
+#ifdef BINARY_UTILS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return HexKernelChoice{ bytes_to_hex_avx2, byte_sum_avx2, hex_to_bytes_avx2,
+                                scan_bytes_avx2, "avx2" };
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return HexKernelChoice{ bytes_to_hex_ssse3, byte_sum_sse2, hex_to_bytes_ssse3,
+                                scan_bytes_sse2, "ssse3" };
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return HexKernelChoice{ bytes_to_hex_scalar, byte_sum_sse2, hex_to_bytes_scalar,
+                                scan_bytes_sse2, "scalar" };
+    }
+#endif
+    return HexKernelChoice{ bytes_to_hex_scalar, byte_sum_scalar, hex_to_bytes_scalar,
+                            scan_bytes_scalar, "scalar" };
+}
+
+const HexKernelChoice& hex_kernel() {
+    static const HexKernelChoice choice = select_hex_kernel();
+    return choice;
+}
+
+} // namespace
+
+char* bytes_to_hex(const uint8_t* data, size_t size, char* out) {
     uint32_t sum = 0;
-    for (uint8_t byte : data) {
-        sum += byte;
+    return hex_kernel().kernel(data, size, out, sum);
+}
+
+char* bytes_to_hex_sum(const uint8_t* data, size_t size, char* out, uint32_t& sum) {
+    return hex_kernel().kernel(data, size, out, sum);
+}
+
+uint32_t byte_sum(const uint8_t* data, size_t size) {
+    return hex_kernel().sum(data, size);
+}
+
+bool hex_to_bytes(const char* text, size_t size, uint8_t* out) {
+    return hex_kernel().decode(text, size, out);
+}
+
+size_t find_byte_run(const uint8_t* data, size_t size, uint8_t value,
+                     size_t min_run, size_t& run_length) {
+    min_run = std::max(size_t(1), min_run);
+    ScanKernel scan = hex_kernel().scan;
+    size_t offset = 0;
+    while (offset < size) {
+        // Find the next candidate, then measure its run, both a vector at a time
+        size_t start = offset + scan(data + offset, size - offset, value, true);
+        if (start == size) {
+            break;
+        }
+        size_t end = start + 1;
+        if (end < size && data[end] == value) {
+            end += scan(data + end, size - end, value, false);
+        }
+        if (end - start >= min_run) {
+            run_length = end - start;
+            return start;
+        }
+        offset = end;
+    }
+    run_length = 0;
+    return size;
+}
+
+namespace {
+
+const uint64_t HASH_PRIME1 = 0x9E3779B185EBCA87ULL;
+const uint64_t HASH_PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t HASH_PRIME3 = 0x165667B19E3779F9ULL;
+const uint64_t HASH_PRIME4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t HASH_PRIME5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotate_left(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t load64(const uint8_t* data) {
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint32_t load32(const uint8_t* data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint64_t hash_round(uint64_t lane, uint64_t input) {
+    lane += input * HASH_PRIME2;
+    return rotate_left(lane, 31) * HASH_PRIME1;
+}
+
+inline uint64_t hash_merge(uint64_t hash, uint64_t lane) {
+    hash ^= hash_round(0, lane);
+    return hash * HASH_PRIME1 + HASH_PRIME4;
+}
+
+} // namespace
+
+uint64_t hash64(const uint8_t* data, size_t size, uint64_t seed) {
+    const uint8_t* end = data + size;
+    uint64_t hash;
+
+    if (size >= 32) {
+        // Four lanes with no dependency on each other
+        uint64_t lane1 = seed + HASH_PRIME1 + HASH_PRIME2;
+        uint64_t lane2 = seed + HASH_PRIME2;
+        uint64_t lane3 = seed;
+        uint64_t lane4 = seed - HASH_PRIME1;
+        const uint8_t* limit = end - 32;
+        do {
+            lane1 = hash_round(lane1, load64(data));
+            lane2 = hash_round(lane2, load64(data + 8));
+            lane3 = hash_round(lane3, load64(data + 16));
+            lane4 = hash_round(lane4, load64(data + 24));
+            data += 32;
+        } while (data <= limit);
+
+        hash = rotate_left(lane1, 1) + rotate_left(lane2, 7) +
+               rotate_left(lane3, 12) + rotate_left(lane4, 18);
+        hash = hash_merge(hash, lane1);
+        hash = hash_merge(hash, lane2);
+        hash = hash_merge(hash, lane3);
+        hash = hash_merge(hash, lane4);
+    } else {
+        hash = seed + HASH_PRIME5;
+    }
+    hash += static_cast<uint64_t>(size);
+
+    // Tail of up to 31 bytes
+    for (; data + 8 <= end; data += 8) {
+        hash ^= hash_round(0, load64(data));
+        hash = rotate_left(hash, 27) * HASH_PRIME1 + HASH_PRIME4;
     }
+    if (data + 4 <= end) {
+        hash ^= static_cast<uint64_t>(load32(data)) * HASH_PRIME1;
+        hash = rotate_left(hash, 23) * HASH_PRIME2 + HASH_PRIME3;
+        data += 4;
+    }
+    for (; data < end; ++data) {
+        hash ^= *data * HASH_PRIME5;
+        hash = rotate_left(hash, 11) * HASH_PRIME1;
+    }
+
+    // Final avalanche
+    hash ^= hash >> 33;
+    hash *= HASH_PRIME2;
+    hash ^= hash >> 29;
+    hash *= HASH_PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+const char* bytes_to_hex_kernel() {
+    return hex_kernel().name;
+}
+
+uint8_t calculate_checksum8(const std::vector<uint8_t>& data) {
+    return calculate_checksum8(data.data(), data.size());
+}
+
+uint8_t calculate_checksum8(const uint8_t* data, size_t size) {
+    uint32_t sum = byte_sum(data, size);
     return static_cast<uint8_t>(256 - (sum & 0xFF));
 }
 
-uint16_t calculate_crc16(const std::vector<uint8_t>& data, 
-                        uint16_t polynomial, uint16_t initial) {
-    uint16_t crc = initial;
-    
-    for (uint8_t byte : data) {
-        crc ^= static_cast<uint16_t>(byte) << 8;
-        
-        for (int i = 0; i < 8; ++i) {
-            if (crc & 0x8000) {
-                crc = (crc << 1) ^ polynomial;
-            } else {
-                crc <<= 1;
+namespace {
+
+inline uint16_t reflect_bits(uint16_t value) {
+    return reflect_word(value);
+}
+
+inline uint32_t reflect_bits(uint32_t value) {
+    return reflect_dword(value);
+}
+
+} // namespace
+
+template <typename Register>
+CrcEngine<Register>::CrcEngine(Register polynomial, bool reflected)
+    : reflected_(reflected) {
+    const int width = sizeof(Register) * 8;
+    const Register top_bit = static_cast<Register>(Register(1) << (width - 1));
+
+    // Byte-at-a-time table, then tables for bytes followed by 1..7 zero bytes
+    if (reflected_) {
+        Register reflected_poly = reflect_bits(polynomial);
+        for (int i = 0; i < 256; ++i) {
+            Register crc = static_cast<Register>(i);
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? static_cast<Register>((crc >> 1) ^ reflected_poly)
+                                : static_cast<Register>(crc >> 1);
+            }
+            table_[0][i] = crc;
+        }
+        for (int k = 1; k < 8; ++k) {
+            for (int i = 0; i < 256; ++i) {
+                Register prev = table_[k - 1][i];
+                table_[k][i] = static_cast<Register>((prev >> 8) ^ table_[0][prev & 0xFF]);
+            }
+        }
+    } else {
+        for (int i = 0; i < 256; ++i) {
+            Register crc = static_cast<Register>(Register(i) << (width - 8));
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & top_bit) ? static_cast<Register>((crc << 1) ^ polynomial)
+                                      : static_cast<Register>(crc << 1);
+            }
+            table_[0][i] = crc;
+        }
+        for (int k = 1; k < 8; ++k) {
+            for (int i = 0; i < 256; ++i) {
+                Register prev = table_[k - 1][i];
+                table_[k][i] = static_cast<Register>((prev << 8) ^
+                                                     table_[0][prev >> (width - 8)]);
             }
         }
     }
-    
+}
+
+template <typename Register>
+Register CrcEngine<Register>::update(Register crc, const uint8_t* data, size_t size) const {
+    const int width = sizeof(Register) * 8;
+    const int register_bytes = sizeof(Register);
+
+    // Slicing-by-8: the register is folded into the first bytes of each
+    // 8-byte block, then all eight bytes are looked up independently
+    while (size >= 8) {
+        uint8_t x[8];
+        for (int j = 0; j < 8; ++j) {
+            x[j] = data[j];
+        }
+        for (int j = 0; j < register_bytes; ++j) {
+            x[j] ^= reflected_ ? static_cast<uint8_t>(crc >> (8 * j))
+                               : static_cast<uint8_t>(crc >> (width - 8 - 8 * j));
+        }
+        crc = static_cast<Register>(table_[7][x[0]] ^ table_[6][x[1]] ^
+                                    table_[5][x[2]] ^ table_[4][x[3]] ^
+                                    table_[3][x[4]] ^ table_[2][x[5]] ^
+                                    table_[1][x[6]] ^ table_[0][x[7]]);
+        data += 8;
+        size -= 8;
+    }
+
+    // Remaining bytes one at a time
+    if (reflected_) {
+        for (size_t i = 0; i < size; ++i) {
+            crc = static_cast<Register>((crc >> 8) ^ table_[0][(crc ^ data[i]) & 0xFF]);
+        }
+    } else {
+        for (size_t i = 0; i < size; ++i) {
+            crc = static_cast<Register>((crc << 8) ^
+                                        table_[0][((crc >> (width - 8)) ^ data[i]) & 0xFF]);
+        }
+    }
+
     return crc;
 }
 
+template <typename Register>
+const CrcEngine<Register>& CrcEngine<Register>::get(Register polynomial, bool reflected) {
+    typedef std::pair<Register, bool> Key;
+    static std::mutex cache_mutex;
+    static std::map<Key, std::unique_ptr<CrcEngine> > cache;
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    std::unique_ptr<CrcEngine>& engine = cache[Key(polynomial, reflected)];
+    if (!engine) {
+        engine.reset(new CrcEngine(polynomial, reflected));
+    }
+    return *engine;
+}
+
+template class CrcEngine<uint16_t>;
+template class CrcEngine<uint32_t>;
+
+namespace {
+
+const uint32_t CRC32_POLYNOMIAL = 0x04C11DB7;
+const uint32_t CRC32C_POLYNOMIAL = 0x1EDC6F41;
+
+#ifdef BINARY_UTILS_X86_SIMD
+
+// x^n mod P for the MSB-first CRC-32 polynomial (folding constants)
+uint32_t crc32_xpow_mod(unsigned n) {
+    uint32_t remainder = 1;
+    for (unsigned i = 0; i < n; ++i) {
+        remainder = (remainder & 0x80000000) ? (remainder << 1) ^ CRC32_POLYNOMIAL
+                                             : (remainder << 1);
+    }
+    return remainder;
+}
+
+// Multiply a 128-bit block by x^D modulo P: the high and low 64-bit halves
+// are multiplied by x^(D+64) and x^D (held in the high/low constant lanes)
+__attribute__((target("pclmul,ssse3")))
+inline __m128i crc32_fold(__m128i block, __m128i constants) {
+    return _mm_xor_si128(_mm_clmulepi64_si128(block, constants, 0x11),
+                         _mm_clmulepi64_si128(block, constants, 0x00));
+}
+
+// Carry-less multiply folding for the MSB-first CRC-32 (0x04C11DB7).
+// Blocks are byte-reversed so the first message bit is the top bit. Four
+// accumulators fold 64 bytes per step and are then merged into one 128-bit
+// remainder congruent to the message; the table engine reduces it to 32
+// bits and finishes the tail. Requires size >= 64.
+__attribute__((target("pclmul,ssse3")))
+uint32_t crc32_update_clmul(uint32_t crc, const uint8_t* data, size_t size) {
+    static const uint32_t k128_lo = crc32_xpow_mod(128);
+    static const uint32_t k128_hi = crc32_xpow_mod(128 + 64);
+    static const uint32_t k512_lo = crc32_xpow_mod(512);
+    static const uint32_t k512_hi = crc32_xpow_mod(512 + 64);
+
+    const __m128i reverse = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8,
+                                          7, 6, 5, 4, 3, 2, 1, 0);
+    const __m128i fold128 = _mm_set_epi32(0, static_cast<int>(k128_hi),
+                                          0, static_cast<int>(k128_lo));
+    const __m128i fold512 = _mm_set_epi32(0, static_cast<int>(k512_hi),
+                                          0, static_cast<int>(k512_lo));
+
+    const __m128i* blocks = reinterpret_cast<const __m128i*>(data);
+    __m128i x0 = _mm_shuffle_epi8(_mm_loadu_si128(blocks + 0), reverse);
+    __m128i x1 = _mm_shuffle_epi8(_mm_loadu_si128(blocks + 1), reverse);
+    __m128i x2 = _mm_shuffle_epi8(_mm_loadu_si128(blocks + 2), reverse);
+    __m128i x3 = _mm_shuffle_epi8(_mm_loadu_si128(blocks + 3), reverse);
+
+    // Initial register is XORed into the first four message bytes
+    x0 = _mm_xor_si128(x0, _mm_set_epi32(static_cast<int>(crc), 0, 0, 0));
+    data += 64;
+    size -= 64;
+
+    while (size >= 64) {
+        blocks = reinterpret_cast<const __m128i*>(data);
+        x0 = _mm_xor_si128(crc32_fold(x0, fold512),
+                           _mm_shuffle_epi8(_mm_loadu_si128(blocks + 0), reverse));
+        x1 = _mm_xor_si128(crc32_fold(x1, fold512),
+                           _mm_shuffle_epi8(_mm_loadu_si128(blocks + 1), reverse));
+        x2 = _mm_xor_si128(crc32_fold(x2, fold512),
+                           _mm_shuffle_epi8(_mm_loadu_si128(blocks + 2), reverse));
+        x3 = _mm_xor_si128(crc32_fold(x3, fold512),
+                           _mm_shuffle_epi8(_mm_loadu_si128(blocks + 3), reverse));
+        data += 64;
+        size -= 64;
+    }
+
+    __m128i x = _mm_xor_si128(crc32_fold(x0, fold128), x1);
+    x = _mm_xor_si128(crc32_fold(x, fold128), x2);
+    x = _mm_xor_si128(crc32_fold(x, fold128), x3);
+
+    while (size >= 16) {
+        x = _mm_xor_si128(crc32_fold(x, fold128),
+                          _mm_shuffle_epi8(_mm_loadu_si128(
+                              reinterpret_cast<const __m128i*>(data)), reverse));
+        data += 16;
+        size -= 16;
+    }
+
+    // CRC of the remainder's 16 bytes (from zero) equals the folded state
+    uint8_t remainder[16];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(remainder), _mm_shuffle_epi8(x, reverse));
+    const Crc32Engine& engine = Crc32Engine::get(CRC32_POLYNOMIAL, false);
+    crc = engine.update(0, remainder, sizeof(remainder));
+    return engine.update(crc, data, size);
+}
+
+// CRC-32C with the SSE4.2 crc32 instruction (reflected 0x1EDC6F41)
+__attribute__((target("sse4.2")))
+uint32_t crc32c_update_sse42(uint32_t crc, const uint8_t* data, size_t size) {
+#ifdef __x86_64__
+    uint64_t crc64 = crc;
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        size -= 8;
+    }
+    crc = static_cast<uint32_t>(crc64);
+#endif
+    while (size >= 4) {
+        uint32_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc = _mm_crc32_u32(crc, word);
+        data += 4;
+        size -= 4;
+    }
+    while (size > 0) {
+        crc = _mm_crc32_u8(crc, *data++);
+        --size;
+    }
+    return crc;
+}
+
+#endif // BINARY_UTILS_X86_SIMD
+
+struct CrcFeatures {
+    bool clmul;
+    bool sse42;
+};
+
+CrcFeatures detect_crc_features() {
+    CrcFeatures features = { false, false };
+#ifdef BINARY_UTILS_X86_SIMD
+    __builtin_cpu_init();
+    features.clmul = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+    features.sse42 = __builtin_cpu_supports("sse4.2");
+#endif
+    return features;
+}
+
+const CrcFeatures& crc_features() {
+    static const CrcFeatures features = detect_crc_features();
+    return features;
+}
+
+} // namespace
+
+uint16_t calculate_crc16(const std::vector<uint8_t>& data, 
+                        uint16_t polynomial, uint16_t initial) {
+    return calculate_crc16(data.data(), data.size(), polynomial, initial, false);
+}
+
+uint16_t calculate_crc16(const uint8_t* data, size_t size,
+                        uint16_t polynomial, uint16_t initial, bool reflected) {
+    return Crc16Engine::get(polynomial, reflected).update(initial, data, size);
+}
+
 uint32_t calculate_crc32(const std::vector<uint8_t>& data,
                         uint32_t polynomial, uint32_t initial) {
-    uint32_t crc = initial;
-    
-    for (uint8_t byte : data) {
-        crc ^= static_cast<uint32_t>(byte) << 24;
-        
-        for (int i = 0; i < 8; ++i) {
-            if (crc & 0x80000000) {
-                crc = (crc << 1) ^ polynomial;
-            } else {
-                crc <<= 1;
-            }
-        }
+    return calculate_crc32(data.data(), data.size(), polynomial, initial, false);
+}
+
+uint32_t calculate_crc32(const uint8_t* data, size_t size,
+                        uint32_t polynomial, uint32_t initial, bool reflected) {
+#ifdef BINARY_UTILS_X86_SIMD
+    // Hardware paths for the two polynomials the CPU can accelerate
+    if (!reflected && polynomial == CRC32_POLYNOMIAL && size >= 64 &&
+        crc_features().clmul) {
+        return crc32_update_clmul(initial, data, size) ^ 0xFFFFFFFF;
+    }
+    if (reflected && polynomial == CRC32C_POLYNOMIAL && crc_features().sse42) {
+        return crc32c_update_sse42(initial, data, size) ^ 0xFFFFFFFF;
     }
-    
-    return crc ^ 0xFFFFFFFF;
+#endif
+    return Crc32Engine::get(polynomial, reflected).update(initial, data, size) ^ 0xFFFFFFFF;
+}
+
+bool parse_checksum_type(const std::string& name, ChecksumType& type) {
+    if (name == "sum8") {
+        type = CHECKSUM_SUM8;
+    } else if (name == "crc16") {
+        type = CHECKSUM_CRC16;
+    } else if (name == "crc32") {
+        type = CHECKSUM_CRC32;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+size_t checksum_width(ChecksumType type) {
+    switch (type) {
+        case CHECKSUM_SUM8: return 1;
+        case CHECKSUM_CRC16: return 2;
+        case CHECKSUM_CRC32: return 4;
+        default: return 0;
+    }
+}
+
+namespace {
+
+// Checksum of a followed by b, as if they were one block
+uint32_t checksum_spans(ChecksumType type,
+                        const uint8_t* a, size_t a_size,
+                        const uint8_t* b, size_t b_size) {
+    switch (type) {
+        case CHECKSUM_SUM8:
+            return static_cast<uint8_t>(256 - ((byte_sum(a, a_size) + byte_sum(b, b_size)) & 0xFF));
+        case CHECKSUM_CRC16:
+            return calculate_crc16(b, b_size, 0x8005, calculate_crc16(a, a_size), false);
+        case CHECKSUM_CRC32:
+            // Undo the final XOR to carry the register over to b
+            return calculate_crc32(b, b_size, CRC32_POLYNOMIAL,
+                                   calculate_crc32(a, a_size) ^ 0xFFFFFFFF, false);
+    }
+    return 0;
+}
+
+void store_checksum(uint8_t* image, uint32_t base_address, const ChecksumSpec& spec,
+                    uint32_t value) {
+    const size_t width = checksum_width(spec.type);
+    uint8_t* out = image + (spec.store_address - base_address);
+    for (size_t i = 0; i < width; ++i) {
+        uint8_t byte = static_cast<uint8_t>(value >> (8 * i));
+        out[spec.big_endian ? width - 1 - i : i] = byte;
+    }
+}
+
+} // namespace
+
+uint32_t embed_checksum(uint8_t* image, size_t size, uint32_t base_address,
+                        const ChecksumSpec& spec) {
+    const uint64_t image_start = base_address;
+    const uint64_t image_end = image_start + size;
+    const uint64_t width = checksum_width(spec.type);
+
+    if (spec.range_end < spec.range_start ||
+        spec.range_start < image_start || spec.range_end >= image_end) {
+        throw std::out_of_range("Checksum range lies outside the image");
+    }
+    if (spec.store_address < image_start ||
+        static_cast<uint64_t>(spec.store_address) + width > image_end) {
+        throw std::out_of_range("Checksum location lies outside the image");
+    }
+    if (spec.store_address <= spec.range_end &&
+        static_cast<uint64_t>(spec.store_address) + width > spec.range_start) {
+        throw std::out_of_range("Checksum location overlaps the checksummed range");
+    }
+
+    const uint8_t* data = image + (spec.range_start - base_address);
+    size_t length = static_cast<size_t>(spec.range_end - spec.range_start) + 1;
+
+    uint32_t value = checksum_spans(spec.type, data, length, nullptr, 0);
+    store_checksum(image, base_address, spec, value);
+    return value;
+}
+
+uint32_t embed_image_checksum(uint8_t* image, size_t size, uint32_t base_address,
+                              const ChecksumSpec& spec) {
+    const uint64_t image_start = base_address;
+    const uint64_t image_end = image_start + size;
+    const uint64_t width = checksum_width(spec.type);
+
+    if (size == 0) {
+        throw std::out_of_range("Cannot checksum an empty image");
+    }
+    if (spec.store_address < image_start ||
+        static_cast<uint64_t>(spec.store_address) + width > image_end) {
+        throw std::out_of_range("Checksum location lies outside the image");
+    }
+
+    size_t before = static_cast<size_t>(spec.store_address - base_address);
+    size_t after = before + static_cast<size_t>(width);
+    uint32_t value = checksum_spans(spec.type, image, before, image + after, size - after);
+    store_checksum(image, base_address, spec, value);
+    return value;
 }
 
 uint8_t reflect_byte(uint8_t value) {
@@ -2,6 +2,7 @@
 #define BINARY_UTILS_HPP
 
 #include <cstdint>
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -12,6 +13,17 @@ namespace BinaryUtils {
  */
 extern const uint8_t reflect_table[256];
 
+/**
+ * Two-character uppercase hex digits for every byte value.
+ * Entry for byte b lives at hex_table[2 * b].
+ */
+extern const char hex_table[513];
+
+/**
+ * Value of every hex digit character, either case; 0xFF for non-digits
+ */
+extern const uint8_t hex_value_table[256];
+
 /**
  * Convert a nibble (4 bits) to ASCII hex character
  */
@@ -23,12 +35,73 @@ inline char nibble_to_hex(uint8_t nibble) {
  * Convert byte to two hex characters
  */
 inline std::string byte_to_hex(uint8_t value) {
-    std::string result(2, '0');
-    result[0] = nibble_to_hex((value >> 4) & 0x0F);
-    result[1] = nibble_to_hex(value & 0x0F);
-    return result;
+    return std::string(hex_table + 2 * value, 2);
+}
+
+/**
+ * Write two hex characters for a byte into a raw buffer
+ * @return Pointer past the last character written
+ */
+inline char* write_hex_byte(char* out, uint8_t value) {
+    const char* digits = hex_table + 2 * value;
+    out[0] = digits[0];
+    out[1] = digits[1];
+    return out + 2;
 }
 
+/**
+ * Convert a block of bytes to uppercase hex, two characters per byte
+ * Uses the fastest kernel the CPU supports (AVX2, SSSE3 or scalar),
+ * selected once at runtime. No terminator is written.
+ * @param data Input bytes
+ * @param size Number of input bytes
+ * @param out Destination, at least 2 * size characters
+ * @return Pointer past the last character written
+ */
+char* bytes_to_hex(const uint8_t* data, size_t size, char* out);
+
+/**
+ * bytes_to_hex that also adds every input byte to sum in the same pass,
+ * so record checksums need no second read of the data
+ */
+char* bytes_to_hex_sum(const uint8_t* data, size_t size, char* out, uint32_t& sum);
+
+/**
+ * Sum of all bytes in a block (vectorized where available)
+ * Wraps modulo 2^32, which is fine for 8-bit checksums.
+ */
+uint32_t byte_sum(const uint8_t* data, size_t size);
+
+/**
+ * Decode 2 * size hex characters (either case) into size bytes
+ * Uses the same runtime-selected SIMD level as bytes_to_hex.
+ * @return false if any character is not a hex digit (out is then undefined)
+ */
+bool hex_to_bytes(const char* text, size_t size, uint8_t* out);
+
+/**
+ * Find the first run of at least min_run consecutive bytes equal to value
+ * Scans with vector compares (SSE2/AVX2, selected like bytes_to_hex), so
+ * long fill runs such as erased flash are skipped at memory speed.
+ * @param run_length Receives the full length of the run found (0 if none)
+ * @return Offset of the run, or size if there is none
+ */
+size_t find_byte_run(const uint8_t* data, size_t size, uint8_t value,
+                     size_t min_run, size_t& run_length);
+
+/**
+ * 64-bit content hash of a block (XXH64)
+ * Four independent multiply-rotate lanes per 32 bytes keep the pipeline
+ * full, so blocks hash at several GB/s. Not a cryptographic hash; used to
+ * tell whether a block changed between runs.
+ */
+uint64_t hash64(const uint8_t* data, size_t size, uint64_t seed = 0);
+
+/**
+ * Name of the kernel bytes_to_hex dispatches to ("avx2", "ssse3" or "scalar")
+ */
+const char* bytes_to_hex_kernel();
+
 /**
  * Convert 16-bit word to four hex characters
  */
@@ -49,6 +122,42 @@ inline std::string dword_to_hex(uint32_t value) {
  * Calculate 8-bit checksum (two's complement)
  */
 uint8_t calculate_checksum8(const std::vector<uint8_t>& data);
+uint8_t calculate_checksum8(const uint8_t* data, size_t size);
+
+/**
+ * Table-driven CRC engine for an arbitrary polynomial
+ * Register is uint16_t (CRC-16) or uint32_t (CRC-32). Tables for
+ * slicing-by-8 are built in the constructor; use get() to share one
+ * engine per polynomial instead of rebuilding them.
+ */
+template <typename Register>
+class CrcEngine {
+public:
+    /**
+     * @param polynomial Generator polynomial in normal (MSB-first) form
+     * @param reflected Process bits LSB-first (e.g. CRC-32/zlib, CRC-16/ARC);
+     *                  the register and initial value are then in reflected order
+     */
+    CrcEngine(Register polynomial, bool reflected);
+
+    /**
+     * Continue a CRC over a block of data
+     * No initial value or final XOR is applied; pass the running register.
+     */
+    Register update(Register crc, const uint8_t* data, size_t size) const;
+
+    /**
+     * Shared engine for a polynomial, built on first use and cached
+     */
+    static const CrcEngine& get(Register polynomial, bool reflected);
+
+private:
+    Register table_[8][256];
+    bool reflected_;
+};
+
+typedef CrcEngine<uint16_t> Crc16Engine;
+typedef CrcEngine<uint32_t> Crc32Engine;
 
 /**
  * Calculate 16-bit CRC using specified polynomial
@@ -57,6 +166,15 @@ uint16_t calculate_crc16(const std::vector<uint8_t>& data,
                         uint16_t polynomial = 0x8005,
                         uint16_t initial = 0x0000);
 
+/**
+ * Calculate 16-bit CRC over a block of data
+ * @param reflected Use the bit-reflected (LSB-first) variant
+ */
+uint16_t calculate_crc16(const uint8_t* data, size_t size,
+                        uint16_t polynomial = 0x8005,
+                        uint16_t initial = 0x0000,
+                        bool reflected = false);
+
 /**
  * Calculate 32-bit CRC using specified polynomial
  */
@@ -64,6 +182,69 @@ uint32_t calculate_crc32(const std::vector<uint8_t>& data,
                         uint32_t polynomial = 0x04C11DB7,
                         uint32_t initial = 0xFFFFFFFF);
 
+/**
+ * Calculate 32-bit CRC over a block of data (result XORed with 0xFFFFFFFF)
+ * @param reflected Use the bit-reflected (LSB-first) variant; with the
+ *                  default polynomial this is the common zlib CRC-32
+ */
+uint32_t calculate_crc32(const uint8_t* data, size_t size,
+                        uint32_t polynomial = 0x04C11DB7,
+                        uint32_t initial = 0xFFFFFFFF,
+                        bool reflected = false);
+
+/**
+ * Image checksum algorithms that can be embedded into an image
+ */
+enum ChecksumType {
+    CHECKSUM_SUM8,      // calculate_checksum8 (1 byte)
+    CHECKSUM_CRC16,     // calculate_crc16 with defaults (2 bytes)
+    CHECKSUM_CRC32      // calculate_crc32 with defaults (4 bytes)
+};
+
+/**
+ * Where and how to compute and store an image checksum
+ * Addresses are absolute; the range end is inclusive.
+ */
+struct ChecksumSpec {
+    ChecksumType type;
+    uint32_t range_start;
+    uint32_t range_end;
+    uint32_t store_address;
+    bool big_endian;
+};
+
+/**
+ * Parse a checksum type name ("sum8", "crc16" or "crc32")
+ */
+bool parse_checksum_type(const std::string& name, ChecksumType& type);
+
+/**
+ * Number of bytes a checksum of the given type occupies
+ */
+size_t checksum_width(ChecksumType type);
+
+/**
+ * Compute a checksum over a range of an image and patch it into the image
+ * @param image Image data, first byte at base_address
+ * @param size Image size in bytes
+ * @param base_address Address of the first image byte
+ * @return The checksum value that was stored
+ * @throws std::out_of_range if the range or location lies outside the image
+ *         or the location overlaps the range
+ */
+uint32_t embed_checksum(uint8_t* image, size_t size, uint32_t base_address,
+                        const ChecksumSpec& spec);
+
+/**
+ * As embed_checksum(), over the whole image but the bytes the checksum is
+ * stored in: the parts before and after them are checksummed as one block
+ * The range in spec is ignored.
+ * @throws std::out_of_range if the image is empty or the location lies
+ *         outside it
+ */
+uint32_t embed_image_checksum(uint8_t* image, size_t size, uint32_t base_address,
+                              const ChecksumSpec& spec);
+
 /**
  * Reflect bits in a byte (reverse bit order)
  */
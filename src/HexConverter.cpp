@@ -1,10 +1,305 @@
 #include "HexConverter.hpp"
 #include "BinaryUtils.hpp"
+#include "Parallel.hpp"
+#include "RecordEncoder.hpp"
+#include "Stats.hpp"
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <sys/stat.h>
+
+const size_t IntelHexConverter::MAX_RECORD_LENGTH;
+
+namespace {
+
+// Characters in a record besides its data digits: ':', byte count,
+// address, type, checksum and the newline
+const uint64_t RECORD_OVERHEAD = 1 + 2 + 4 + 2 + 2 + 1;
+const uint64_t EXTENDED_RECORD_SIZE = RECORD_OVERHEAD + 4;
+const uint64_t EOF_RECORD_SIZE = RECORD_OVERHEAD;
+
+/**
+ * Intel HEX format policy for RecordEncoder
+ * Records break every bytes_per_line bytes and at each 64KB boundary, and
+ * a region's first record follows an extended linear address record.
+ */
+class IntelHexFormat {
+public:
+    /**
+     * Encoder position carried across chunks
+     */
+    struct State {
+        uint32_t current_address;
+        uint32_t extended_address;
+        bool use_extended_address;
+    };
+
+    explicit IntelHexFormat(size_t bytes_per_line) : bytes_per_line_(bytes_per_line) {}
+
+    size_t max_record_bytes() const { return bytes_per_line_; }
+
+    size_t record_bytes(const State& state, size_t remaining) const {
+        size_t to_boundary = 0x10000 - (state.current_address & 0xFFFF);
+        return std::min(std::min(bytes_per_line_, to_boundary), remaining);
+    }
+
+    char* write_record(char* out, State& state, const uint8_t* data, size_t count) const {
+        // Open a new 64KB region with its extended address
+        if (state.use_extended_address &&
+            (state.current_address >> 16) != state.extended_address) {
+            state.extended_address = state.current_address >> 16;
+            const uint8_t ext_data[2] = {
+                static_cast<uint8_t>(state.extended_address >> 8),
+                static_cast<uint8_t>(state.extended_address & 0xFF)
+            };
+            out += IntelHexConverter::write_record(out, 2, 0,
+                                                   IntelHexConverter::EXTENDED_LINEAR_ADDRESS,
+                                                   ext_data);
+            *out++ = '\n';
+        }
+
+        // Format the data record straight from the input buffer
+        out += IntelHexConverter::write_record(out,
+                                               static_cast<uint8_t>(count),
+                                               static_cast<uint16_t>(state.current_address & 0xFFFF),
+                                               IntelHexConverter::DATA_RECORD,
+                                               data);
+        *out++ = '\n';
+        state.current_address += static_cast<uint32_t>(count);
+        return out;
+    }
+
+    uint64_t records_size(uint64_t size, State& state) const {
+        uint64_t extended_records = 0;
+        uint64_t records = count_records(size, state, extended_records);
+        return 2 * size + records * RECORD_OVERHEAD + extended_records * EXTENDED_RECORD_SIZE;
+    }
+
+    /**
+     * Lines records_size() accounts for, advancing state the same way
+     */
+    uint64_t record_count(uint64_t size, State& state) const {
+        uint64_t extended_records = 0;
+        uint64_t records = count_records(size, state, extended_records);
+        return records + extended_records;
+    }
+
+    size_t complete_records(size_t size, const State& state) const {
+        // Records end every bytes_per_line bytes from the start, restarting
+        // at each 64KB boundary
+        uint64_t start = state.current_address;
+        uint64_t end = start + size;
+        uint64_t region = end & ~uint64_t(0xFFFF);
+        uint64_t base = std::max(region, start);
+        return static_cast<size_t>(base + (end - base) / bytes_per_line_ * bytes_per_line_ - start);
+    }
+
+    void split(const State& state, size_t size, std::vector<size_t>& offsets) const {
+        // Chunks end on 64KB boundaries, where records split anyway and
+        // every chunk opens with its own extended address record
+        size_t offset = 0;
+        size_t region_room = 0x10000 - (state.current_address & 0xFFFF);
+        while (offset < size) {
+            offsets.push_back(offset);
+            offset += std::min(region_room, size - offset);
+            region_room = 0x10000;
+        }
+        offsets.push_back(size);
+    }
+
+    State chunk_state(const State& state, size_t offset) const {
+        // Later chunks start a new 64KB region, so only the first one can
+        // continue the caller's extended address
+        State chunk = {
+            static_cast<uint32_t>(state.current_address + offset),
+            (offset == 0) ? state.extended_address : 0xFFFFFFFF,
+            state.use_extended_address
+        };
+        return chunk;
+    }
+
+private:
+    /**
+     * Data records for size bytes, with the extended address records they
+     * need in extended_records; advances state past them
+     */
+    uint64_t count_records(uint64_t size, State& state, uint64_t& extended_records) const {
+        extended_records = 0;
+        if (size == 0) {
+            return 0;
+        }
+
+        // Count the records in the partial first region, the full ones and
+        // the partial last
+        const uint64_t region = 0x10000;
+        uint64_t first = std::min(size, region - (state.current_address & 0xFFFF));
+        uint64_t full_regions = (size - first) / region;
+        uint64_t tail = (size - first) % region;
+        uint64_t records = (first + bytes_per_line_ - 1) / bytes_per_line_ +
+                           full_regions * ((region + bytes_per_line_ - 1) / bytes_per_line_) +
+                           (tail + bytes_per_line_ - 1) / bytes_per_line_;
+
+        // Each region opens with an extended address record unless the
+        // previous block left the first one current
+        if (state.use_extended_address) {
+            extended_records = 1 + full_regions + (tail > 0 ? 1 : 0);
+            if ((state.current_address >> 16) == state.extended_address) {
+                --extended_records;
+            }
+            state.extended_address = static_cast<uint32_t>(state.current_address + size - 1) >> 16;
+        }
+        state.current_address = static_cast<uint32_t>(state.current_address + size);
+
+        return records;
+    }
+
+    size_t bytes_per_line_;
+};
+
+// Sidecar index of an incremental conversion: the magic, then the fields
+// of BlockIndex as little-endian 64-bit words, then one hash per block
+const char INDEX_MAGIC[8] = { 'B', '2', 'H', 'I', 'D', 'X', '0', '1' };
+const size_t INDEX_HEADER_WORDS = 7;
+
+/**
+ * What an incremental conversion produced, and from which input blocks
+ */
+struct BlockIndex {
+    uint64_t bytes_per_line;
+    uint64_t use_extended_address;
+    uint64_t start_address;
+    uint64_t input_size;
+    uint64_t output_size;
+    uint64_t output_mtime;
+    std::vector<uint64_t> hashes;
+};
+
+/**
+ * true if both indexes describe the same record layout, so every block
+ * encodes to the same range of the output
+ */
+bool same_layout(const BlockIndex& a, const BlockIndex& b) {
+    return a.bytes_per_line == b.bytes_per_line &&
+           a.use_extended_address == b.use_extended_address &&
+           a.start_address == b.start_address &&
+           a.input_size == b.input_size &&
+           a.hashes.size() == b.hashes.size();
+}
+
+/**
+ * Size and modification time (in nanoseconds) of a file
+ * @return false if it does not exist
+ */
+bool file_signature(const std::string& filename, uint64_t& size, uint64_t& mtime) {
+    struct stat info;
+    if (::stat(filename.c_str(), &info) != 0) {
+        return false;
+    }
+    size = static_cast<uint64_t>(info.st_size);
+#if defined(__APPLE__)
+    mtime = static_cast<uint64_t>(info.st_mtimespec.tv_sec) * 1000000000u + info.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+    mtime = static_cast<uint64_t>(info.st_mtime) * 1000000000u;
+#else
+    mtime = static_cast<uint64_t>(info.st_mtim.tv_sec) * 1000000000u + info.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+void put_word(std::string& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+uint64_t get_word(const char* in) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | static_cast<uint8_t>(in[i]);
+    }
+    return value;
+}
+
+/**
+ * Load an index written by write_block_index()
+ * @return false if it is missing, truncated or not an index
+ */
+bool read_block_index(const std::string& filename, BlockIndex& index) {
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const size_t header = sizeof(INDEX_MAGIC) + 8 * INDEX_HEADER_WORDS;
+    if (bytes.size() < header || std::memcmp(bytes.data(), INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) {
+        return false;
+    }
+
+    const char* p = bytes.data() + sizeof(INDEX_MAGIC);
+    index.bytes_per_line = get_word(p);
+    index.use_extended_address = get_word(p + 8);
+    index.start_address = get_word(p + 16);
+    index.input_size = get_word(p + 24);
+    index.output_size = get_word(p + 32);
+    index.output_mtime = get_word(p + 40);
+    uint64_t block_count = get_word(p + 48);
+    if (block_count != (bytes.size() - header) / 8 || (bytes.size() - header) % 8 != 0) {
+        return false;
+    }
+
+    index.hashes.resize(static_cast<size_t>(block_count));
+    for (size_t i = 0; i < index.hashes.size(); ++i) {
+        index.hashes[i] = get_word(bytes.data() + header + 8 * i);
+    }
+    return true;
+}
+
+/**
+ * Replace an index file; a temporary file is renamed over it, so readers
+ * never see half an index
+ * @throws std::runtime_error if it cannot be written
+ */
+void write_block_index(const std::string& filename, const BlockIndex& index) {
+    std::string bytes(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    put_word(bytes, index.bytes_per_line);
+    put_word(bytes, index.use_extended_address);
+    put_word(bytes, index.start_address);
+    put_word(bytes, index.input_size);
+    put_word(bytes, index.output_size);
+    put_word(bytes, index.output_mtime);
+    put_word(bytes, index.hashes.size());
+    for (size_t i = 0; i < index.hashes.size(); ++i) {
+        put_word(bytes, index.hashes[i]);
+    }
+
+    std::string temporary = filename + ".tmp";
+    {
+        std::ofstream out(temporary.c_str(), std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        out.close();
+        if (!out) {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Cannot write index file: " + filename);
+        }
+    }
+#ifdef _WIN32
+    // rename() does not replace an existing file here
+    std::remove(filename.c_str());
+#endif
+    if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Cannot write index file: " + filename);
+    }
+}
+
+} // namespace
+
+const size_t IntelHexConverter::DEFAULT_CHUNK_SIZE;
 
 IntelHexConverter::IntelHexConverter(size_t bytes_per_line)
-    : bytes_per_line_(bytes_per_line) {
+    : bytes_per_line_(bytes_per_line), chunk_size_(DEFAULT_CHUNK_SIZE), thread_count_(1),
+      mapped_output_(false), stats_(nullptr), block_count_(0), blocks_encoded_(0) {
     // Clamp bytes per line to reasonable values
     bytes_per_line_ = std::max(size_t(1), std::min(size_t(255), bytes_per_line_));
 }
@@ -13,58 +308,208 @@ bool IntelHexConverter::convert_to_hex(const std::vector<uint8_t>& binary_data,
                                       uint32_t start_address,
                                       const std::string& output_file,
                                       bool use_extended_address) {
-    std::ofstream out(output_file);
-    if (!out.is_open()) {
-        last_error_ = "Failed to open output file: " + output_file;
+    return convert_to_hex(binary_data.data(), binary_data.size(),
+                          start_address, output_file, use_extended_address);
+}
+
+bool IntelHexConverter::convert_to_hex(const uint8_t* data,
+                                      size_t size,
+                                      uint32_t start_address,
+                                      const std::string& output_file,
+                                      bool use_extended_address) {
+    std::unique_ptr<OutputSink> out;
+    return open_output(out, output_file) &&
+           convert_to_hex(data, size, start_address, *out, use_extended_address) &&
+           close_output(*out, output_file);
+}
+
+bool IntelHexConverter::convert_to_hex(const uint8_t* data,
+                                      size_t size,
+                                      uint32_t start_address,
+                                      OutputSink& output,
+                                      bool use_extended_address) {
+    try {
+        output.reserve(encoded_size(size, start_address, use_extended_address));
+
+        IntelHexFormat format(bytes_per_line_);
+        IntelHexFormat::State state = { start_address, 0xFFFFFFFF, use_extended_address };
+        RecordEncoder::write_block(format, output, data, size, state, thread_count_, chunk_size_);
+
+        std::string text;
+        format_eof_record(text);
+        output.write(text.data(), text.size());
+
+        output.flush();
+        return true;
+
+    } catch (const std::exception& e) {
+        last_error_ = "Exception during conversion: " + std::string(e.what());
+        return false;
+    }
+}
+
+bool IntelHexConverter::convert_to_hex(const uint8_t* data,
+                                      size_t size,
+                                      uint32_t start_address,
+                                      char* buffer,
+                                      size_t capacity,
+                                      size_t& written,
+                                      bool use_extended_address) {
+    BufferSink out(buffer, capacity);
+    if (!convert_to_hex(data, size, start_address, out, use_extended_address)) {
+        return false;
+    }
+    written = out.size();
+    return true;
+}
+
+bool IntelHexConverter::convert_to_hex(const MemoryImage& image,
+                                      const std::string& output_file,
+                                      bool use_extended_address) {
+    std::unique_ptr<OutputSink> out;
+    return open_output(out, output_file) &&
+           convert_to_hex(image, *out, use_extended_address) &&
+           close_output(*out, output_file);
+}
+
+bool IntelHexConverter::convert_to_hex(const MemoryImage& image,
+                                      OutputSink& output,
+                                      bool use_extended_address) {
+    try {
+        output.reserve(encoded_size(image, use_extended_address));
+
+        // The extended address carries over, so it is only repeated when a
+        // segment starts in a new 64KB region
+        IntelHexFormat format(bytes_per_line_);
+        IntelHexFormat::State state = { 0, 0xFFFFFFFF, use_extended_address };
+        const MemoryImage::SegmentMap& segments = image.segments();
+        for (MemoryImage::SegmentMap::const_iterator it = segments.begin();
+             it != segments.end(); ++it) {
+            state.current_address = it->first;
+            RecordEncoder::write_block(format, output, it->second.data(), it->second.size(),
+                                       state, thread_count_, chunk_size_);
+        }
+
+        std::string text;
+        format_eof_record(text);
+        output.write(text.data(), text.size());
+
+        output.flush();
+        return true;
+
+    } catch (const std::exception& e) {
+        last_error_ = "Exception during conversion: " + std::string(e.what());
+        return false;
+    }
+}
+
+bool IntelHexConverter::convert_to_hex(const MemoryImage& image,
+                                      char* buffer,
+                                      size_t capacity,
+                                      size_t& written,
+                                      bool use_extended_address) {
+    BufferSink out(buffer, capacity);
+    if (!convert_to_hex(image, out, use_extended_address)) {
         return false;
     }
+    written = out.size();
+    return true;
+}
 
+bool IntelHexConverter::convert_to_hex_incremental(const uint8_t* data,
+                                                  size_t size,
+                                                  uint32_t start_address,
+                                                  const std::string& output_file,
+                                                  const std::string& index_file,
+                                                  bool use_extended_address) {
+    block_count_ = 0;
+    blocks_encoded_ = 0;
     try {
-        uint32_t current_address = start_address;
-        uint32_t extended_address = 0xFFFFFFFF;
-        size_t data_offset = 0;
-
-        while (data_offset < binary_data.size()) {
-            // Check if we need to output an extended address record
-            if (use_extended_address && (current_address >> 16) != extended_address) {
-                extended_address = current_address >> 16;
-                std::string ext_record = generate_extended_address_record(current_address);
-                out << ext_record << std::endl;
+        // Blocks are the parallel encoder's chunks: each starts a 64KB
+        // region with its own extended address record, so its text depends
+        // on nothing but its own bytes and address
+        IntelHexFormat format(bytes_per_line_);
+        IntelHexFormat::State state = { start_address, 0xFFFFFFFF, use_extended_address };
+        std::vector<size_t> block_offsets;
+        std::vector<uint64_t> text_offsets;
+        uint64_t total = RecordEncoder::chunk_layout(format, state, size, block_offsets, text_offsets) +
+                         EOF_RECORD_SIZE;
+        size_t block_count = block_offsets.size() - 1;
+
+        BlockIndex index;
+        index.bytes_per_line = bytes_per_line_;
+        index.use_extended_address = use_extended_address ? 1 : 0;
+        index.start_address = start_address;
+        index.input_size = size;
+        index.output_size = 0;
+        index.output_mtime = 0;
+        index.hashes.resize(block_count);
+        Parallel::run(block_count, thread_count_, [&](size_t i) {
+            index.hashes[i] = BinaryUtils::hash64(data + block_offsets[i],
+                                                  block_offsets[i + 1] - block_offsets[i]);
+        });
+
+        // The old output is only patched if it is still exactly what the
+        // index says was written
+        BlockIndex cached;
+        uint64_t output_size = 0;
+        uint64_t output_mtime = 0;
+        bool reuse = read_block_index(index_file, cached) && same_layout(cached, index) &&
+                     file_signature(output_file, output_size, output_mtime) &&
+                     output_size == cached.output_size && output_mtime == cached.output_mtime;
+
+        // A run cut short must not leave an index for half-patched output
+        std::remove(index_file.c_str());
+
+        std::vector<size_t> changed;
+        for (size_t i = 0; i < block_count; ++i) {
+            if (!reuse || index.hashes[i] != cached.hashes[i]) {
+                changed.push_back(i);
             }
+        }
 
-            // Calculate how many bytes to write in this record
-            size_t bytes_remaining = binary_data.size() - data_offset;
-            size_t bytes_this_line = std::min(bytes_per_line_, bytes_remaining);
-            
-            // Handle address wraparound within 64KB boundary
-            size_t max_bytes_to_boundary = 0x10000 - (current_address & 0xFFFF);
-            bytes_this_line = std::min(bytes_this_line, max_bytes_to_boundary);
-
-            // Extract data for this record
-            std::vector<uint8_t> line_data(
-                binary_data.begin() + data_offset,
-                binary_data.begin() + data_offset + bytes_this_line
-            );
-
-            // Generate and write the data record
-            std::string record = generate_record(
-                static_cast<uint8_t>(bytes_this_line),
-                static_cast<uint16_t>(current_address & 0xFFFF),
-                DATA_RECORD,
-                line_data
-            );
-            out << record << std::endl;
-
-            // Update counters
-            data_offset += bytes_this_line;
-            current_address += bytes_this_line;
+        std::unique_ptr<OutputSink> out;
+        if (reuse && !changed.empty()) {
+            if (!open_output(out, output_file, true)) {
+                return false;
+            }
+            // Without positional writes the text can only be rewritten in full
+            reuse = out->positional();
         }
 
-        // Write end-of-file record
-        std::string eof_record = generate_record(0, 0, EOF_RECORD, {});
-        out << eof_record << std::endl;
+        if (!reuse) {
+            out.reset();
+            if (!convert_to_hex(data, size, start_address, output_file, use_extended_address)) {
+                return false;
+            }
+            blocks_encoded_ = block_count;
+        } else {
+            if (out) {
+                RecordEncoder::write_chunks(format, *out, data, state, block_offsets, text_offsets,
+                                            changed, thread_count_);
+                out->advance(total);
+                StageTimer timer(stats_, ConversionStats::STAGE_WRITE);
+                if (!close_output(*out, output_file)) {
+                    return false;
+                }
+            }
+            blocks_encoded_ = changed.size();
 
-        out.close();
+            // Like a full conversion, report the whole output rather than
+            // the patched part of it
+            if (stats_) {
+                IntelHexFormat::State count_state = state;
+                stats_->add_output_bytes(total);
+                stats_->add_records(format.record_count(size, count_state) + 1);  // With EOF
+            }
+        }
+        block_count_ = block_count;
+
+        // Text mode line endings can make the file longer than the text
+        if (!file_signature(output_file, index.output_size, index.output_mtime)) {
+            throw std::runtime_error("Cannot read output file: " + output_file);
+        }
+        write_block_index(index_file, index);
         return true;
 
     } catch (const std::exception& e) {
@@ -73,56 +518,119 @@ bool IntelHexConverter::convert_to_hex(const std::vector<uint8_t>& binary_data,
     }
 }
 
-std::string IntelHexConverter::generate_record(uint8_t byte_count,
-                                              uint16_t address,
-                                              uint8_t record_type,
-                                              const std::vector<uint8_t>& data) {
-    std::string record = ":";
-    
-    // Byte count
-    record += BinaryUtils::byte_to_hex(byte_count);
-    
-    // Address (big endian)
-    record += BinaryUtils::byte_to_hex(static_cast<uint8_t>(address >> 8));
-    record += BinaryUtils::byte_to_hex(static_cast<uint8_t>(address & 0xFF));
-    
-    // Record type
-    record += BinaryUtils::byte_to_hex(record_type);
-    
-    // Data bytes
-    for (uint8_t byte : data) {
-        record += BinaryUtils::byte_to_hex(byte);
-    }
-    
-    // Checksum
-    uint8_t checksum = calculate_checksum(byte_count, address, record_type, data);
-    record += BinaryUtils::byte_to_hex(checksum);
-    
-    return record;
-}
-
-std::string IntelHexConverter::generate_extended_address_record(uint32_t address) {
-    uint16_t extended_addr = static_cast<uint16_t>(address >> 16);
-    std::vector<uint8_t> addr_data = {
-        static_cast<uint8_t>(extended_addr >> 8),
-        static_cast<uint8_t>(extended_addr & 0xFF)
-    };
-    
-    return generate_record(2, 0, EXTENDED_LINEAR_ADDRESS, addr_data);
-}
-
-uint8_t IntelHexConverter::calculate_checksum(uint8_t byte_count,
-                                             uint16_t address,
-                                             uint8_t record_type,
-                                             const std::vector<uint8_t>& data) {
-    uint32_t sum = byte_count;
-    sum += (address >> 8) & 0xFF;
-    sum += address & 0xFF;
-    sum += record_type;
-    
-    for (uint8_t byte : data) {
-        sum += byte;
-    }
-    
-    return static_cast<uint8_t>((256 - (sum & 0xFF)) & 0xFF);
-}
\ No newline at end of file
+bool IntelHexConverter::convert_to_hex(InputSource& input,
+                                      uint32_t start_address,
+                                      const std::string& output_file,
+                                      bool use_extended_address) {
+    std::unique_ptr<OutputSink> out;
+    return open_output(out, output_file) &&
+           convert_to_hex(input, start_address, *out, use_extended_address) &&
+           close_output(*out, output_file);
+}
+
+bool IntelHexConverter::convert_to_hex(InputSource& input,
+                                      uint32_t start_address,
+                                      OutputSink& output,
+                                      bool use_extended_address) {
+    try {
+        IntelHexFormat format(bytes_per_line_);
+        IntelHexFormat::State state = { start_address, 0xFFFFFFFF, use_extended_address };
+        RecordEncoder::write_stream(format, input, output, state, chunk_size_);
+
+        std::string text;
+        format_eof_record(text);
+        output.write(text.data(), text.size());
+
+        output.flush();
+        return true;
+
+    } catch (const std::exception& e) {
+        last_error_ = "Exception during conversion: " + std::string(e.what());
+        return false;
+    }
+}
+
+uint64_t IntelHexConverter::encoded_size(uint64_t size,
+                                        uint32_t start_address,
+                                        bool use_extended_address) const {
+    IntelHexFormat::State state = { start_address, 0xFFFFFFFF, use_extended_address };
+    return IntelHexFormat(bytes_per_line_).records_size(size, state) + EOF_RECORD_SIZE;
+}
+
+uint64_t IntelHexConverter::encoded_size(const MemoryImage& image,
+                                        bool use_extended_address) const {
+    IntelHexFormat format(bytes_per_line_);
+    IntelHexFormat::State state = { 0, 0xFFFFFFFF, use_extended_address };
+    uint64_t total = EOF_RECORD_SIZE;
+    const MemoryImage::SegmentMap& segments = image.segments();
+    for (MemoryImage::SegmentMap::const_iterator it = segments.begin();
+         it != segments.end(); ++it) {
+        state.current_address = it->first;
+        total += format.records_size(it->second.size(), state);
+    }
+    return total;
+}
+
+bool IntelHexConverter::open_output(std::unique_ptr<OutputSink>& out, const std::string& output_file,
+                                    bool update) {
+    try {
+        StageTimer timer(stats_, ConversionStats::STAGE_WRITE);
+        if (update) {
+            out.reset(new FileSink(output_file, FileSink::UPDATE));
+        } else if (mapped_output_) {
+            out.reset(new MappedFileSink(output_file));
+        } else {
+            out.reset(new FileSink(output_file));
+        }
+        if (stats_ && !update) {
+            out.reset(new StatsSink(std::move(out), *stats_));
+        }
+        return true;
+    } catch (const std::exception&) {
+        last_error_ = "Failed to open output file: " + output_file;
+        return false;
+    }
+}
+
+bool IntelHexConverter::close_output(OutputSink& out, const std::string& output_file) {
+    try {
+        out.close();
+        return true;
+    } catch (const std::exception&) {
+        last_error_ = "Error writing output file: " + output_file;
+        return false;
+    }
+}
+
+void IntelHexConverter::format_eof_record(std::string& text) const {
+    char line[MAX_RECORD_LENGTH + 1];
+    size_t line_length = write_record(line, 0, 0, EOF_RECORD, nullptr);
+    line[line_length++] = '\n';
+    text.append(line, line_length);
+}
+
+size_t IntelHexConverter::write_record(char* out,
+                                      uint8_t byte_count,
+                                      uint16_t address,
+                                      uint8_t record_type,
+                                      const uint8_t* data) {
+    char* p = out;
+    *p++ = ':';
+
+    // Byte count, address (big endian) and record type
+    const uint8_t addr_hi = static_cast<uint8_t>(address >> 8);
+    const uint8_t addr_lo = static_cast<uint8_t>(address & 0xFF);
+    p = BinaryUtils::write_hex_byte(p, byte_count);
+    p = BinaryUtils::write_hex_byte(p, addr_hi);
+    p = BinaryUtils::write_hex_byte(p, addr_lo);
+    p = BinaryUtils::write_hex_byte(p, record_type);
+    uint32_t sum = byte_count + addr_hi + addr_lo + record_type;
+
+    // Data bytes, summed while they are formatted
+    p = BinaryUtils::bytes_to_hex_sum(data, byte_count, p, sum);
+
+    // Checksum (two's complement)
+    p = BinaryUtils::write_hex_byte(p, static_cast<uint8_t>(0x100 - (sum & 0xFF)));
+
+    return static_cast<size_t>(p - out);
+}
@@ -2,9 +2,15 @@
 #define HEX_CONVERTER_HPP
 
 #include <cstdint>
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <vector>
-#include <fstream>
+#include "InputSource.hpp"
+#include "MemoryImage.hpp"
+#include "OutputSink.hpp"
+
+class ConversionStats;
 
 /**
  * Intel HEX file format converter
@@ -21,6 +27,16 @@ public:
         START_LINEAR_ADDRESS = 0x05
     };
 
+    /**
+     * Longest record text (255 data bytes), excluding the line terminator
+     */
+    static const size_t MAX_RECORD_LENGTH = 1 + 2 * (1 + 2 + 1 + 255 + 1);
+
+    /**
+     * Default number of input bytes pulled per chunk when streaming
+     */
+    static const size_t DEFAULT_CHUNK_SIZE = 1024 * 1024;
+
     /**
      * Constructor
      * @param bytes_per_line Number of data bytes per line (typically 16 or 32)
@@ -40,6 +56,187 @@ public:
                        const std::string& output_file,
                        bool use_extended_address = true);
 
+    /**
+     * Convert a binary data view to Intel HEX format
+     * The data is read in place (e.g. from a memory-mapped file), never copied.
+     * @param data Pointer to the input bytes
+     * @param size Number of input bytes
+     * @param start_address Starting address for the data
+     * @param output_file Output file path
+     * @param use_extended_address Use extended linear addressing for addresses > 64KB
+     * @return true on success, false on error
+     */
+    bool convert_to_hex(const uint8_t* data,
+                       size_t size,
+                       uint32_t start_address,
+                       const std::string& output_file,
+                       bool use_extended_address = true);
+
+    /**
+     * As above, writing the records to an output sink instead of a file
+     * The sink is flushed on success.
+     */
+    bool convert_to_hex(const uint8_t* data,
+                       size_t size,
+                       uint32_t start_address,
+                       OutputSink& output,
+                       bool use_extended_address = true);
+
+    /**
+     * As above, writing the records into a caller-provided buffer
+     * Size the buffer with encoded_size(); no memory is allocated for the text.
+     * @param buffer Destination for the record text
+     * @param capacity Size of buffer in bytes
+     * @param written Set to the length of the text on success
+     * @return true on success, false on error (including a buffer that is too small)
+     */
+    bool convert_to_hex(const uint8_t* data,
+                       size_t size,
+                       uint32_t start_address,
+                       char* buffer,
+                       size_t capacity,
+                       size_t& written,
+                       bool use_extended_address = true);
+
+    /**
+     * Convert a binary data view to Intel HEX, re-encoding only the blocks
+     * that changed since the last conversion to the same file
+     * The input is hashed in blocks ending on 64KB boundaries, each of
+     * which encodes to a fixed range of the output. index_file keeps the
+     * hashes with the layout and the output file's size and modification
+     * time; while those still match, only blocks with a new hash are
+     * encoded and written over their old text. Anything else (no index, a
+     * new size, address or line length, an output edited since) falls
+     * back to a full conversion. The output is the same either way.
+     * @param output_file Output file path, patched in place when possible
+     * @param index_file Sidecar index, rewritten on success
+     * @return true on success, false on error
+     */
+    bool convert_to_hex_incremental(const uint8_t* data,
+                                    size_t size,
+                                    uint32_t start_address,
+                                    const std::string& output_file,
+                                    const std::string& index_file,
+                                    bool use_extended_address = true);
+
+    /**
+     * Blocks the input of the last incremental conversion was split into
+     */
+    size_t get_block_count() const { return block_count_; }
+
+    /**
+     * Blocks the last incremental conversion encoded (all of them when it
+     * fell back to a full conversion)
+     */
+    size_t get_blocks_encoded() const { return blocks_encoded_; }
+
+    /**
+     * Convert a stream of binary data to Intel HEX format
+     * Input is pulled in chunks, so memory use is bounded by the chunk size.
+     * Produces exactly the same records as the in-memory overload.
+     * @param input Source of binary data
+     * @param start_address Starting address for the data
+     * @param output_file Output file path
+     * @param use_extended_address Use extended linear addressing for addresses > 64KB
+     * @return true on success, false on error
+     */
+    bool convert_to_hex(InputSource& input,
+                       uint32_t start_address,
+                       const std::string& output_file,
+                       bool use_extended_address = true);
+
+    /**
+     * As above, writing the records to an output sink instead of a file
+     * The sink is flushed on success.
+     */
+    bool convert_to_hex(InputSource& input,
+                       uint32_t start_address,
+                       OutputSink& output,
+                       bool use_extended_address = true);
+
+    /**
+     * Convert a sparse memory image to Intel HEX format
+     * Only populated segments produce data records, so gaps cost nothing.
+     * An extended linear address record is written wherever a segment
+     * starts in a different 64KB region than the previous record.
+     * @param image Input segments (views are read in place)
+     * @param output_file Output file path
+     * @param use_extended_address Use extended linear addressing for addresses > 64KB
+     * @return true on success, false on error
+     */
+    bool convert_to_hex(const MemoryImage& image,
+                       const std::string& output_file,
+                       bool use_extended_address = true);
+
+    /**
+     * As above, writing the records to an output sink instead of a file
+     * The sink is flushed on success.
+     */
+    bool convert_to_hex(const MemoryImage& image,
+                       OutputSink& output,
+                       bool use_extended_address = true);
+
+    /**
+     * As above, writing the records into a caller-provided buffer
+     * @param written Set to the length of the text on success
+     * @return true on success, false on error (including a buffer that is too small)
+     */
+    bool convert_to_hex(const MemoryImage& image,
+                       char* buffer,
+                       size_t capacity,
+                       size_t& written,
+                       bool use_extended_address = true);
+
+    /**
+     * Exact length of the text convert_to_hex() produces for size bytes
+     * at start_address, worked out from the record layout alone
+     * Lets callers allocate the output once; the sink-based overloads
+     * pass it to OutputSink::reserve() themselves.
+     */
+    uint64_t encoded_size(uint64_t size,
+                          uint32_t start_address,
+                          bool use_extended_address = true) const;
+
+    /**
+     * Exact length of the text convert_to_hex() produces for an image
+     */
+    uint64_t encoded_size(const MemoryImage& image,
+                          bool use_extended_address = true) const;
+
+    /**
+     * Set the chunk size used when streaming from an InputSource
+     */
+    void set_chunk_size(size_t chunk_size) {
+        chunk_size_ = std::max(size_t(1), chunk_size);
+    }
+
+    /**
+     * Set the number of threads used to format in-memory input
+     * With more than one thread the input is split at 64KB segment
+     * boundaries and chunks are formatted concurrently; the output is
+     * byte-identical to the single-threaded result.
+     */
+    void set_thread_count(unsigned thread_count) {
+        thread_count_ = std::max(1u, thread_count);
+    }
+
+    /**
+     * Write output files through a shared memory mapping (MappedFileSink)
+     * Records are then formatted straight into the file's pages by every
+     * thread, which pays off for multi-GB outputs on fast local storage.
+     */
+    void set_mapped_output(bool mapped_output) {
+        mapped_output_ = mapped_output;
+    }
+
+    /**
+     * Time and count the output of path-based conversions into stats
+     * (--stats); null turns it off again. The caller keeps ownership.
+     */
+    void set_stats(ConversionStats* stats) {
+        stats_ = stats;
+    }
+
     /**
      * Set bytes per line for output formatting
      */
@@ -52,30 +249,48 @@ public:
      */
     const std::string& get_last_error() const { return last_error_; }
 
-private:
-    size_t bytes_per_line_;
-    std::string last_error_;
-
     /**
-     * Generate a single Intel HEX record
+     * Format a single Intel HEX record into a caller-provided buffer.
+     * The checksum is accumulated in the same pass as the hex digits.
+     * @param out Destination, at least MAX_RECORD_LENGTH characters
+     * @param data byte_count data bytes (may be null when byte_count is 0)
+     * @return Number of characters written (no line terminator)
      */
-    std::string generate_record(uint8_t byte_count,
+    static size_t write_record(char* out,
+                               uint8_t byte_count,
                                uint16_t address,
                                uint8_t record_type,
-                               const std::vector<uint8_t>& data);
+                               const uint8_t* data);
+
+private:
+    /**
+     * Create the output file for a path-based conversion
+     * @param update Open the existing file to patch it in place instead;
+     *               the caller then books the output to stats_ itself
+     * @return false (with last_error_ set) if it cannot be opened
+     */
+    bool open_output(std::unique_ptr<OutputSink>& out, const std::string& output_file,
+                     bool update = false);
 
     /**
-     * Generate extended linear address record
+     * Close a path-based conversion's output file
+     * @return false (with last_error_ set) if a write or the close failed
      */
-    std::string generate_extended_address_record(uint32_t address);
+    bool close_output(OutputSink& out, const std::string& output_file);
+
+    size_t bytes_per_line_;
+    size_t chunk_size_;
+    unsigned thread_count_;
+    bool mapped_output_;
+    ConversionStats* stats_;
+    size_t block_count_;
+    size_t blocks_encoded_;
+    std::string last_error_;
 
     /**
-     * Calculate Intel HEX checksum
+     * Append the end-of-file record to text
      */
-    uint8_t calculate_checksum(uint8_t byte_count,
-                              uint16_t address,
-                              uint8_t record_type,
-                              const std::vector<uint8_t>& data);
+    void format_eof_record(std::string& text) const;
 };
 
 #endif // HEX_CONVERTER_HPP
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "HexParser.hpp"
+#include "HexConverter.hpp"
+#include "BinaryUtils.hpp"
+#include <algorithm>
+
+IntelHexParser::IntelHexParser()
+    : has_start_address_(false), start_address_(0), record_count_(0) {
+}
+
+bool IntelHexParser::parse(const char* text, size_t size, MemoryImage& image) {
+    uint32_t upper_address = 0;
+    size_t line = 0;
+    size_t pos = 0;
+    bool end_of_file = false;
+
+    has_start_address_ = false;
+    start_address_ = 0;
+    record_count_ = 0;
+
+    while (pos < size && !end_of_file) {
+        // Skip line terminators and blank lines
+        char c = text[pos];
+        if (c == '\n' || c == '\r' || c == ' ' || c == '\t') {
+            if (c == '\n') {
+                ++line;
+            }
+            ++pos;
+            continue;
+        }
+        if (c != ':') {
+            return fail(line, "Expected ':' at start of record");
+        }
+
+        // Header: byte count, 16-bit address, record type
+        uint8_t header[4];
+        if (size - pos < 11 || !BinaryUtils::hex_to_bytes(text + pos + 1, 4, header)) {
+            return fail(line, "Malformed record header");
+        }
+        uint8_t byte_count = header[0];
+        uint16_t offset = static_cast<uint16_t>((header[1] << 8) | header[2]);
+        uint8_t record_type = header[3];
+
+        size_t record_length = 1 + 2 * (5 + static_cast<size_t>(byte_count));
+        if (size - pos < record_length) {
+            return fail(line, "Truncated record");
+        }
+        const char* data_text = text + pos + 9;
+        uint8_t checksum;
+        if (!BinaryUtils::hex_to_bytes(data_text + 2 * byte_count, 1, &checksum)) {
+            return fail(line, "Invalid hex digit in checksum");
+        }
+        uint32_t sum = header[0] + header[1] + header[2] + header[3] + checksum;
+
+        if (record_type == IntelHexConverter::DATA_RECORD) {
+            // Decode straight into the image, then verify the checksum. The
+            // 16-bit offset wraps within the segment, so a record crossing
+            // its end continues at the segment base.
+            size_t done = 0;
+            uint32_t run_offset = offset;
+            while (done < byte_count) {
+                size_t run = std::min<size_t>(byte_count - done, 0x10000 - run_offset);
+                uint8_t* dest = image.allocate(upper_address + run_offset, run);
+                if (!BinaryUtils::hex_to_bytes(data_text + 2 * done, run, dest)) {
+                    return fail(line, "Invalid hex digit in data");
+                }
+                sum += BinaryUtils::byte_sum(dest, run);
+                done += run;
+                run_offset = 0;
+            }
+            if (sum & 0xFF) {
+                return fail(line, "Checksum mismatch");
+            }
+        } else {
+            // Address, start and end records are short
+            uint8_t data[255];
+            if (!BinaryUtils::hex_to_bytes(data_text, byte_count, data)) {
+                return fail(line, "Invalid hex digit in data");
+            }
+            sum += BinaryUtils::byte_sum(data, byte_count);
+            if (sum & 0xFF) {
+                return fail(line, "Checksum mismatch");
+            }
+
+            switch (record_type) {
+                case IntelHexConverter::EOF_RECORD:
+                    end_of_file = true;
+                    break;
+                case IntelHexConverter::EXTENDED_SEGMENT_ADDRESS:
+                    if (byte_count != 2) {
+                        return fail(line, "Extended segment address record must hold 2 bytes");
+                    }
+                    upper_address = static_cast<uint32_t>((data[0] << 8) | data[1]) << 4;
+                    break;
+                case IntelHexConverter::EXTENDED_LINEAR_ADDRESS:
+                    if (byte_count != 2) {
+                        return fail(line, "Extended linear address record must hold 2 bytes");
+                    }
+                    upper_address = static_cast<uint32_t>((data[0] << 8) | data[1]) << 16;
+                    break;
+                case IntelHexConverter::START_SEGMENT_ADDRESS:
+                case IntelHexConverter::START_LINEAR_ADDRESS:
+                    if (byte_count != 4) {
+                        return fail(line, "Start address record must hold 4 bytes");
+                    }
+                    has_start_address_ = true;
+                    start_address_ = (static_cast<uint32_t>(data[0]) << 24) |
+                                     (static_cast<uint32_t>(data[1]) << 16) |
+                                     (static_cast<uint32_t>(data[2]) << 8) |
+                                     data[3];
+                    break;
+                default:
+                    return fail(line, "Unknown record type");
+            }
+        }
+
+        ++record_count_;
+        pos += record_length;
+    }
+
+    if (!end_of_file) {
+        return fail(line, "Missing end-of-file record");
+    }
+    return true;
+}
+
+bool IntelHexParser::fail(size_t line, const std::string& message) {
+    last_error_ = "Line " + std::to_string(line + 1) + ": " + message;
+    return false;
+}
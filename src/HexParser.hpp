@@ -0,0 +1,60 @@
+#ifndef HEX_PARSER_HPP
+#define HEX_PARSER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "MemoryImage.hpp"
+
+/**
+ * Intel HEX file format parser
+ * Decodes Intel HEX text (record types 00-05) into a sparse memory image.
+ * The reverse of IntelHexConverter.
+ */
+class IntelHexParser {
+public:
+    IntelHexParser();
+
+    /**
+     * Decode Intel HEX text into image
+     * Records are parsed in place from the buffer (e.g. a memory-mapped
+     * file) and data bytes are decoded straight into the image, so
+     * records far apart cost no memory for the gap between them. Every
+     * record checksum is verified.
+     * @param text Intel HEX text
+     * @param size Text length in bytes
+     * @param image Destination; existing contents are overwritten where
+     *              records overlap them
+     * @return true on success, false on error (see get_last_error())
+     */
+    bool parse(const char* text, size_t size, MemoryImage& image);
+
+    /**
+     * Start address from a type 03 (CS:IP) or 05 (EIP) record, if any
+     */
+    bool has_start_address() const { return has_start_address_; }
+    uint32_t get_start_address() const { return start_address_; }
+
+    /**
+     * Number of records decoded by the last parse
+     */
+    size_t get_record_count() const { return record_count_; }
+
+    /**
+     * Get the last error message
+     */
+    const std::string& get_last_error() const { return last_error_; }
+
+private:
+    std::string last_error_;
+    bool has_start_address_;
+    uint32_t start_address_;
+    size_t record_count_;
+
+    /**
+     * Record an error for the given line
+     */
+    bool fail(size_t line, const std::string& message);
+};
+
+#endif // HEX_PARSER_HPP
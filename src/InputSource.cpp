@@ -0,0 +1,102 @@
+#include "InputSource.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+FileInputSource::FileInputSource(const std::string& filename)
+    : file_(filename, std::ios::binary), filename_(filename), size_(0) {
+    if (!file_.is_open()) {
+        throw std::runtime_error("Cannot open input file: " + filename);
+    }
+
+    // Get file size
+    file_.seekg(0, std::ios::end);
+    std::streamsize size = file_.tellg();
+    file_.seekg(0, std::ios::beg);
+
+    if (size < 0) {
+        throw std::runtime_error("Cannot determine file size: " + filename);
+    }
+    size_ = static_cast<uint64_t>(size);
+}
+
+size_t FileInputSource::read(uint8_t* buffer, size_t size) {
+    file_.read(reinterpret_cast<char*>(buffer), static_cast<std::streamsize>(size));
+    if (file_.bad()) {
+        throw std::runtime_error("Error reading file: " + filename_);
+    }
+    return static_cast<size_t>(file_.gcount());
+}
+
+size_t MemoryInputSource::read(uint8_t* buffer, size_t size) {
+    size_t count = std::min(size, size_ - offset_);
+    if (count > 0) {
+        std::memcpy(buffer, data_ + offset_, count);
+        offset_ += count;
+    }
+    return count;
+}
+
+#ifndef _WIN32
+
+MappedFile::MappedFile(const std::string& filename, bool writable)
+    : data_(nullptr), size_(0), mapped_(false), writable_(writable) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open input file: " + filename);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot determine file size: " + filename);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+
+    // Zero-length mappings are not allowed, an empty file needs none
+    if (size_ > 0) {
+        int protection = writable_ ? (PROT_READ | PROT_WRITE) : PROT_READ;
+        void* addr = mmap(nullptr, size_, protection, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Cannot map input file: " + filename);
+        }
+        madvise(addr, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<uint8_t*>(addr);
+        mapped_ = true;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (mapped_) {
+        munmap(data_, size_);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filename, bool writable)
+    : data_(nullptr), size_(0), mapped_(false), writable_(writable) {
+    FileInputSource input(filename);
+    fallback_.resize(static_cast<size_t>(input.size()));
+    if (input.read(fallback_.data(), fallback_.size()) != fallback_.size()) {
+        throw std::runtime_error("Error reading file: " + filename);
+    }
+    data_ = fallback_.data();
+    size_ = fallback_.size();
+}
+
+MappedFile::~MappedFile() {
+}
+
+#endif
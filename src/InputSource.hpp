@@ -0,0 +1,106 @@
+#ifndef INPUT_SOURCE_HPP
+#define INPUT_SOURCE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <fstream>
+
+/**
+ * Sequential source of binary input data
+ * Lets the converters pull fixed-size chunks instead of needing the whole
+ * image in memory.
+ */
+class InputSource {
+public:
+    virtual ~InputSource() {}
+
+    /**
+     * Read up to size bytes into buffer
+     * @return Number of bytes read, 0 at end of input
+     * @throws std::runtime_error on read errors
+     */
+    virtual size_t read(uint8_t* buffer, size_t size) = 0;
+};
+
+/**
+ * Input source reading from a binary file
+ */
+class FileInputSource : public InputSource {
+public:
+    /**
+     * Open a file for reading
+     * @throws std::runtime_error if the file cannot be opened
+     */
+    explicit FileInputSource(const std::string& filename);
+
+    size_t read(uint8_t* buffer, size_t size) override;
+
+    /**
+     * Total size of the file in bytes
+     */
+    uint64_t size() const { return size_; }
+
+private:
+    std::ifstream file_;
+    std::string filename_;
+    uint64_t size_;
+};
+
+/**
+ * Input source reading from a memory buffer (not copied)
+ */
+class MemoryInputSource : public InputSource {
+public:
+    MemoryInputSource(const uint8_t* data, size_t size)
+        : data_(data), size_(size), offset_(0) {}
+
+    explicit MemoryInputSource(const std::vector<uint8_t>& data)
+        : data_(data.data()), size_(data.size()), offset_(0) {}
+
+    size_t read(uint8_t* buffer, size_t size) override;
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t offset_;
+};
+
+/**
+ * Memory mapping of a whole input file
+ * Gives the converters a pointer/length view without copying the file.
+ * Platforms without mmap fall back to reading the file into memory.
+ */
+class MappedFile {
+public:
+    /**
+     * Map a file for reading
+     * @param writable Map copy-on-write so the image can be patched in
+     *                 memory; only touched pages are copied and changes
+     *                 never reach the file
+     * @throws std::runtime_error if the file cannot be opened or mapped
+     */
+    explicit MappedFile(const std::string& filename, bool writable = false);
+    ~MappedFile();
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    /**
+     * Writable view of the data, null unless mapped writable
+     */
+    uint8_t* mutable_data() { return writable_ ? data_ : nullptr; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    uint8_t* data_;
+    size_t size_;
+    bool mapped_;
+    bool writable_;
+    std::vector<uint8_t> fallback_;
+};
+
+#endif // INPUT_SOURCE_HPP
@@ -0,0 +1,85 @@
+#include "InputSpec.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <sys/stat.h>
+
+bool parse_hex_value(const std::string& str, uint32_t& value) {
+    try {
+        size_t pos;
+        if (str.substr(0, 2) == "0x" || str.substr(0, 2) == "0X") {
+            value = std::stoul(str.substr(2), &pos, 16);
+        } else {
+            value = std::stoul(str, &pos, 16);
+        }
+        return pos == str.length() - (str.substr(0, 2) == "0x" || str.substr(0, 2) == "0X" ? 2 : 0);
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+std::string get_base_filename(const std::string& path) {
+    size_t last_slash = path.find_last_of("/\\");
+    size_t start = (last_slash == std::string::npos) ? 0 : last_slash + 1;
+    
+    size_t last_dot = path.find_last_of('.');
+    size_t end = (last_dot == std::string::npos || last_dot < start) ? path.length() : last_dot;
+    
+    return path.substr(start, end - start);
+}
+
+InputFile parse_input_spec(const std::string& arg) {
+    InputFile input = { arg, 0, false };
+
+    // A file that exists under the whole name keeps it, '@' and all
+    struct stat info;
+    if (::stat(arg.c_str(), &info) == 0) {
+        return input;
+    }
+
+    size_t at = arg.rfind('@');
+    uint32_t address;
+    if (at != std::string::npos && at > 0 && parse_hex_value(arg.substr(at + 1), address)) {
+        input.filename = arg.substr(0, at);
+        input.address = address;
+        input.address_set = true;
+    }
+    return input;
+}
+
+void load_inputs(const std::vector<InputFile>& inputs,
+                 bool skip_fill,
+                 uint8_t fill_byte,
+                 size_t skip_min_run,
+                 std::vector<std::unique_ptr<MappedFile>>& files,
+                 MemoryImage& image) {
+    std::vector<size_t> order;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        files.emplace_back(new MappedFile(inputs[i].filename));
+        order.push_back(i);
+    }
+
+    // Only neighbours in address order can overlap
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return inputs[a].address < inputs[b].address;
+    });
+    for (size_t k = 0; k < order.size(); ++k) {
+        const InputFile& input = inputs[order[k]];
+        uint64_t end = static_cast<uint64_t>(input.address) + files[order[k]]->size();
+        if (end > MemoryImage::ADDRESS_LIMIT) {
+            throw std::runtime_error("Input runs past the 32-bit address space: " + input.filename);
+        }
+        if (k + 1 < order.size() && end > inputs[order[k + 1]].address) {
+            throw std::runtime_error("Inputs overlap: " + input.filename + " and " +
+                                     inputs[order[k + 1]].filename);
+        }
+    }
+
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (skip_fill) {
+            image.add_view_skip_fill(inputs[i].address, files[i]->data(), files[i]->size(),
+                                     fill_byte, skip_min_run);
+        } else {
+            image.add_view(inputs[i].address, files[i]->data(), files[i]->size());
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef INPUT_SPEC_HPP
+#define INPUT_SPEC_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "InputSource.hpp"
+#include "MemoryImage.hpp"
+
+/**
+ * Command-line input handling shared by the converters and decoders
+ */
+
+/**
+ * One input file and the address it is placed at
+ */
+struct InputFile {
+    std::string filename;
+    uint32_t address;
+    bool address_set;
+};
+
+/**
+ * Parse a hex value, with or without a 0x prefix
+ * @return false unless the whole string is a hex number
+ */
+bool parse_hex_value(const std::string& str, uint32_t& value);
+
+/**
+ * File name without its directory and extension
+ */
+std::string get_base_filename(const std::string& path);
+
+/**
+ * Split "file@address" into its parts
+ * A plain file name (or one whose text after '@' is not an address) has no
+ * address of its own, and neither does the name of an existing file, so
+ * names like "fw@beef" still work.
+ */
+InputFile parse_input_spec(const std::string& arg);
+
+/**
+ * Map every input and place it in the image at its address, without copying
+ * @param skip_fill Leave runs of at least skip_min_run fill_byte bytes out
+ * @throws std::runtime_error if inputs overlap or run past the 32-bit address space
+ */
+void load_inputs(const std::vector<InputFile>& inputs,
+                 bool skip_fill,
+                 uint8_t fill_byte,
+                 size_t skip_min_run,
+                 std::vector<std::unique_ptr<MappedFile>>& files,
+                 MemoryImage& image);
+
+#endif // INPUT_SPEC_HPP
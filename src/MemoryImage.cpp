@@ -0,0 +1,191 @@
+#include "MemoryImage.hpp"
+#include "BinaryUtils.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+
+const uint64_t MemoryImage::ADDRESS_LIMIT;
+
+MemoryImage::MemoryImage() : last_(segments_.end()) {
+}
+
+MemoryImage::MemoryImage(const MemoryImage& other)
+    : segments_(other.segments_), last_(segments_.end()) {
+}
+
+MemoryImage& MemoryImage::operator=(const MemoryImage& other) {
+    segments_ = other.segments_;
+    last_ = segments_.end();
+    return *this;
+}
+
+uint8_t* MemoryImage::allocate(uint32_t address, size_t size) {
+    if (size == 0) {
+        return nullptr;
+    }
+    uint64_t end = static_cast<uint64_t>(address) + size;
+    if (end > ADDRESS_LIMIT) {
+        throw std::out_of_range("Memory image range runs past the 32-bit address space");
+    }
+
+    // Fast path: inside, or growing the end of, the segment touched last
+    if (last_ != segments_.end()) {
+        uint64_t start = last_->first;
+        std::vector<uint8_t>& bytes = last_->second.bytes_;
+        if (address >= start && address <= start + bytes.size()) {
+            if (end > start + bytes.size()) {
+                // Growing must not reach the next segment, that needs a merge
+                SegmentMap::iterator next = std::next(last_);
+                if (next != segments_.end() && end >= next->first) {
+                    return allocate_merged(address, size);
+                }
+                bytes.resize(static_cast<size_t>(end - start));
+            }
+            return bytes.data() + (address - start);
+        }
+    }
+
+    return allocate_merged(address, size);
+}
+
+uint8_t* MemoryImage::allocate_merged(uint32_t address, size_t size) {
+    uint64_t start = address;
+    uint64_t end = start + size;
+
+    // First segment that overlaps or touches the range
+    SegmentMap::iterator first = segments_.upper_bound(address);
+    if (first != segments_.begin()) {
+        SegmentMap::iterator prev = std::prev(first);
+        if (prev->first + static_cast<uint64_t>(prev->second.size()) >= start) {
+            first = prev;
+        }
+    }
+
+    // One past the last segment that overlaps or touches it
+    SegmentMap::iterator last = first;
+    while (last != segments_.end() && last->first <= end) {
+        end = std::max(end, last->first + static_cast<uint64_t>(last->second.size()));
+        ++last;
+    }
+
+    if (first == last) {
+        // Nothing to merge with
+        last_ = segments_.emplace_hint(first, address, Segment());
+        last_->second.bytes_.resize(size);
+        return last_->second.bytes_.data();
+    }
+
+    SegmentMap::iterator target;
+    if (first->first <= start && !first->second.is_view()) {
+        // Grow the first segment in place and copy the rest into it
+        start = first->first;
+        target = first++;
+        target->second.bytes_.resize(static_cast<size_t>(end - start));
+        for (SegmentMap::iterator it = first; it != last; ++it) {
+            std::memcpy(target->second.bytes_.data() + (it->first - start),
+                        it->second.data(), it->second.size());
+        }
+        segments_.erase(first, last);
+    } else {
+        // Copy everything, views included, into a new owned segment
+        start = std::min(start, static_cast<uint64_t>(first->first));
+        Segment merged;
+        merged.bytes_.resize(static_cast<size_t>(end - start));
+        for (SegmentMap::iterator it = first; it != last; ++it) {
+            std::memcpy(merged.bytes_.data() + (it->first - start),
+                        it->second.data(), it->second.size());
+        }
+        SegmentMap::iterator hint = segments_.erase(first, last);
+        target = segments_.emplace_hint(hint, static_cast<uint32_t>(start), Segment());
+        target->second.bytes_.swap(merged.bytes_);
+    }
+
+    last_ = target;
+    return target->second.bytes_.data() + (address - start);
+}
+
+void MemoryImage::write(uint32_t address, const uint8_t* data, size_t size) {
+    uint8_t* dest = allocate(address, size);
+    if (dest) {
+        std::memcpy(dest, data, size);
+    }
+}
+
+void MemoryImage::add_view(uint32_t address, const uint8_t* data, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    uint64_t end = static_cast<uint64_t>(address) + size;
+    if (end > ADDRESS_LIMIT) {
+        throw std::out_of_range("Memory image range runs past the 32-bit address space");
+    }
+
+    // Overlapping bytes have to be merged, which means copying
+    SegmentMap::iterator next = segments_.upper_bound(address);
+    bool overlaps = (next != segments_.end() && next->first < end);
+    if (next != segments_.begin()) {
+        SegmentMap::iterator prev = std::prev(next);
+        overlaps = overlaps || prev->first + static_cast<uint64_t>(prev->second.size()) > address;
+    }
+    if (overlaps) {
+        write(address, data, size);
+        return;
+    }
+
+    SegmentMap::iterator it = segments_.emplace_hint(next, address, Segment());
+    it->second.view_ = data;
+    it->second.view_size_ = size;
+}
+
+void MemoryImage::add_view_skip_fill(uint32_t address, const uint8_t* data, size_t size,
+                                     uint8_t fill, size_t min_run) {
+    size_t offset = 0;
+    while (offset < size) {
+        size_t run_length;
+        size_t run = offset + BinaryUtils::find_byte_run(data + offset, size - offset,
+                                                         fill, min_run, run_length);
+        add_view(static_cast<uint32_t>(address + offset), data + offset, run - offset);
+        offset = run + run_length;
+    }
+}
+
+uint32_t MemoryImage::low_address() const {
+    return segments_.empty() ? 0 : segments_.begin()->first;
+}
+
+uint64_t MemoryImage::high_address() const {
+    if (segments_.empty()) {
+        return 0;
+    }
+    SegmentMap::const_iterator last = std::prev(segments_.end());
+    return last->first + static_cast<uint64_t>(last->second.size());
+}
+
+uint64_t MemoryImage::byte_count() const {
+    uint64_t count = 0;
+    for (SegmentMap::const_iterator it = segments_.begin(); it != segments_.end(); ++it) {
+        count += it->second.size();
+    }
+    return count;
+}
+
+void MemoryImage::clear() {
+    segments_.clear();
+    last_ = segments_.end();
+}
+
+void MemoryImage::write_flat(std::ostream& out, uint8_t fill) const {
+    std::vector<char> gap_bytes(64 * 1024, static_cast<char>(fill));
+    uint64_t position = low_address();
+    for (SegmentMap::const_iterator it = segments_.begin(); it != segments_.end(); ++it) {
+        while (position < it->first) {
+            size_t gap = static_cast<size_t>(std::min<uint64_t>(gap_bytes.size(), it->first - position));
+            out.write(gap_bytes.data(), gap);
+            position += gap;
+        }
+        out.write(reinterpret_cast<const char*>(it->second.data()), it->second.size());
+        position += it->second.size();
+    }
+}
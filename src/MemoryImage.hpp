@@ -0,0 +1,132 @@
+#ifndef MEMORY_IMAGE_HPP
+#define MEMORY_IMAGE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <iosfwd>
+#include <map>
+#include <vector>
+
+/**
+ * Sparse memory image over a 32-bit address space
+ * Populated bytes are kept as a sorted map of non-overlapping segments
+ * (start address -> byte run). Unpopulated addresses take no memory.
+ *
+ * A segment either owns its bytes or is a view of caller memory (e.g. a
+ * memory-mapped input file), so large inputs can be placed without copying.
+ * Owned segments merge with anything they overlap or touch; a view that
+ * is written to is copied into owned storage first.
+ */
+class MemoryImage {
+public:
+    /**
+     * One contiguous run of populated bytes
+     */
+    class Segment {
+    public:
+        Segment() : view_(nullptr), view_size_(0) {}
+
+        const uint8_t* data() const { return view_ ? view_ : bytes_.data(); }
+        size_t size() const { return view_ ? view_size_ : bytes_.size(); }
+
+        /**
+         * true if the bytes belong to the caller rather than the image
+         */
+        bool is_view() const { return view_ != nullptr; }
+
+    private:
+        friend class MemoryImage;
+
+        std::vector<uint8_t> bytes_;
+        const uint8_t* view_;
+        size_t view_size_;
+    };
+
+    typedef std::map<uint32_t, Segment> SegmentMap;
+
+    /**
+     * One past the highest address an image can hold
+     */
+    static const uint64_t ADDRESS_LIMIT = 0x100000000ULL;
+
+    MemoryImage();
+
+    MemoryImage(const MemoryImage& other);
+    MemoryImage& operator=(const MemoryImage& other);
+
+    /**
+     * Make [address, address + size) populated and return its storage
+     * Existing bytes in the range are kept; new bytes are zero until written.
+     * Appending right after the last range touched is amortized O(1), which
+     * is the common case when records are decoded in address order.
+     * The pointer is invalidated by the next call that modifies the image.
+     * @return Pointer to the first byte, or nullptr when size is 0
+     * @throws std::out_of_range if the range runs past ADDRESS_LIMIT
+     */
+    uint8_t* allocate(uint32_t address, size_t size);
+
+    /**
+     * Copy bytes into the image, overwriting anything already there
+     * @throws std::out_of_range if the range runs past ADDRESS_LIMIT
+     */
+    void write(uint32_t address, const uint8_t* data, size_t size);
+
+    /**
+     * Place caller memory at address without copying it
+     * The memory must outlive the image. Views are not merged with
+     * neighbouring segments; a range overlapping existing bytes is copied
+     * in with write() instead.
+     * @throws std::out_of_range if the range runs past ADDRESS_LIMIT
+     */
+    void add_view(uint32_t address, const uint8_t* data, size_t size);
+
+    /**
+     * add_view() for everything except runs of at least min_run fill bytes
+     * Blank (e.g. erased flash) regions are left unpopulated, so they
+     * produce no records when the image is converted.
+     */
+    void add_view_skip_fill(uint32_t address, const uint8_t* data, size_t size,
+                            uint8_t fill, size_t min_run);
+
+    /**
+     * Populated segments in address order
+     */
+    const SegmentMap& segments() const { return segments_; }
+
+    bool empty() const { return segments_.empty(); }
+
+    /**
+     * Lowest populated address (0 for an empty image)
+     */
+    uint32_t low_address() const;
+
+    /**
+     * One past the highest populated address (0 for an empty image)
+     */
+    uint64_t high_address() const;
+
+    /**
+     * Number of populated bytes
+     */
+    uint64_t byte_count() const;
+
+    /**
+     * Write the image as flat binary from low_address() to high_address(),
+     * filling the gaps between segments with fill
+     * Gaps are written from a small buffer, so segments far apart cost no
+     * memory beyond their own bytes. Check out for write errors.
+     */
+    void write_flat(std::ostream& out, uint8_t fill) const;
+
+    void clear();
+
+private:
+    SegmentMap segments_;
+
+    // Segment touched by the last allocate(), for the append fast path
+    SegmentMap::iterator last_;
+
+    uint8_t* allocate_merged(uint32_t address, size_t size);
+};
+
+#endif // MEMORY_IMAGE_HPP
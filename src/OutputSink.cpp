@@ -0,0 +1,532 @@
+#include "OutputSink.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#else
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+const size_t FdSink::DEFAULT_BUFFER_SIZE;
+
+void OutputSink::write_at(uint64_t, const char*, size_t) {
+    throw std::logic_error("Output does not support positional writes");
+}
+
+void OutputSink::advance(uint64_t) {
+    throw std::logic_error("Output does not support positional writes");
+}
+
+void MemorySink::reserve(uint64_t size) {
+    if (size > text_.max_size() - text_.size()) {
+        throw std::length_error("Output too large for memory");
+    }
+    text_.reserve(text_.size() + static_cast<size_t>(size));
+}
+
+void BufferSink::write(const char* data, size_t size) {
+    if (size > capacity_ - used_) {
+        throw std::length_error("Output buffer too small");
+    }
+    std::memcpy(buffer_ + used_, data, size);
+    used_ += size;
+}
+
+void BufferSink::reserve(uint64_t size) {
+    // Fail before any formatting work rather than part way through
+    if (size > capacity_ - used_) {
+        throw std::length_error("Output buffer too small");
+    }
+}
+
+void BufferSink::write_at(uint64_t offset, const char* data, size_t size) {
+    if (offset > capacity_ - used_ || size > capacity_ - used_ - offset) {
+        throw std::length_error("Output buffer too small");
+    }
+    std::memcpy(buffer_ + used_ + offset, data, size);
+}
+
+void BufferSink::advance(uint64_t size) {
+    if (size > capacity_ - used_) {
+        throw std::length_error("Output buffer too small");
+    }
+    used_ += static_cast<size_t>(size);
+}
+
+char* BufferSink::direct(uint64_t size) {
+    if (size > capacity_ - used_) {
+        throw std::length_error("Output buffer too small");
+    }
+    return buffer_ + used_;
+}
+
+namespace {
+
+/**
+ * Capacity to grow an output of used bytes to, to fit size more
+ * Reservations are exact; plain writes grow geometrically, in steps of
+ * at most 1 GiB so a large file is not doubled for a few trailing bytes.
+ */
+uint64_t grown_capacity(uint64_t capacity, uint64_t used, uint64_t size, bool exact) {
+    uint64_t needed = used + size;
+    if (exact) {
+        return needed;
+    }
+    const uint64_t min_step = 1024 * 1024;
+    const uint64_t max_step = 1024 * 1024 * 1024;
+    return std::max(needed, capacity + std::max(min_step, std::min(capacity, max_step)));
+}
+
+} // namespace
+
+void MappedFileSink::write(const char* data, size_t size) {
+    ensure(size, false);
+    std::memcpy(data_ + used_, data, size);
+    used_ += size;
+}
+
+void MappedFileSink::reserve(uint64_t size) {
+    ensure(size, true);
+}
+
+char* MappedFileSink::direct(uint64_t size) {
+    ensure(size, false);
+    return data_ + used_;
+}
+
+void MappedFileSink::advance(uint64_t size) {
+    if (size > capacity_ - used_) {
+        throw std::logic_error("Advanced past the mapped output");
+    }
+    used_ += size;
+}
+
+MappedFileSink::~MappedFileSink() {
+    try {
+        close();
+    } catch (const std::exception&) {
+        // Reported by an explicit close() only
+    }
+}
+
+#ifndef _WIN32
+namespace {
+
+/**
+ * true if pwrite(2) can place bytes at an offset of the descriptor
+ */
+bool supports_pwrite(int fd) {
+    struct stat info;
+    if (fd < 0 || ::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        return false;
+    }
+    // pwrite(2) ignores the offset when O_APPEND is set
+    int flags = ::fcntl(fd, F_GETFL);
+    return flags >= 0 && (flags & O_APPEND) == 0;
+}
+
+} // namespace
+#endif
+
+FdSink::FdSink(int fd, size_t buffer_size)
+    : fd_(fd), buffer_(std::max(size_t(1), buffer_size)), used_(0), write_calls_(0),
+#ifndef _WIN32
+      seekable_(supports_pwrite(fd)) {
+#else
+      seekable_(false) {
+#endif
+}
+
+FdSink::~FdSink() {
+    try {
+        flush();
+    } catch (const std::exception&) {
+        // Reported by an explicit flush() or close() only
+    }
+}
+
+void FdSink::write(const char* data, size_t size) {
+    if (size <= buffer_.size() - used_) {
+        std::memcpy(buffer_.data() + used_, data, size);
+        used_ += size;
+        return;
+    }
+    write_through(data, size);
+}
+
+void FdSink::flush() {
+    if (used_ > 0) {
+        write_through(nullptr, 0);
+    }
+}
+
+#ifndef _WIN32
+
+void FdSink::write_through(const char* data, size_t size) {
+    struct iovec parts[2];
+    parts[0].iov_base = buffer_.data();
+    parts[0].iov_len = used_;
+    parts[1].iov_base = const_cast<char*>(data);
+    parts[1].iov_len = size;
+    struct iovec* part = parts;
+    int part_count = 2;
+
+    while (part_count > 0) {
+        // Skip parts that are done (or empty)
+        if (part->iov_len == 0) {
+            ++part;
+            --part_count;
+            continue;
+        }
+        ssize_t written = ::writev(fd_, part, part_count);
+        ++write_calls_;
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            used_ = 0;
+            throw std::runtime_error(std::string("Write failed: ") + std::strerror(errno));
+        }
+
+        // Advance past what a short write managed to send
+        size_t remaining = static_cast<size_t>(written);
+        while (part_count > 0 && remaining >= part->iov_len) {
+            remaining -= part->iov_len;
+            ++part;
+            --part_count;
+        }
+        if (part_count > 0) {
+            part->iov_base = static_cast<char*>(part->iov_base) + remaining;
+            part->iov_len -= remaining;
+        }
+    }
+    used_ = 0;
+}
+
+void FdSink::reserve(uint64_t size) {
+    if (!seekable_ || size == 0) {
+        return;
+    }
+    off_t position = ::lseek(fd_, 0, SEEK_CUR);
+    if (position < 0) {
+        return;
+    }
+    off_t length = static_cast<off_t>(used_ + size);
+
+#ifdef __linux__
+    // Filesystems without fallocate support just grow the file as usual
+    if (::fallocate(fd_, 0, position, length) != 0 && errno == ENOSPC) {
+        throw std::runtime_error("Not enough space for the output");
+    }
+#else
+    // Sets the length up front; close() trims it if less is written
+    if (::ftruncate(fd_, position + length) != 0 && errno == ENOSPC) {
+        throw std::runtime_error("Not enough space for the output");
+    }
+#endif
+}
+
+void FdSink::write_at(uint64_t offset, const char* data, size_t size) {
+    if (!seekable_) {
+        OutputSink::write_at(offset, data, size);
+    }
+    if (used_ != 0) {
+        throw std::logic_error("Buffered output must be flushed before write_at()");
+    }
+    off_t position = ::lseek(fd_, 0, SEEK_CUR);
+    if (position < 0) {
+        throw std::runtime_error(std::string("Write failed: ") + std::strerror(errno));
+    }
+    position += static_cast<off_t>(offset);
+
+    while (size > 0) {
+        ssize_t written = ::pwrite(fd_, data, size, position);
+        ++write_calls_;
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Write failed: ") + std::strerror(errno));
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+        position += written;
+    }
+}
+
+void FdSink::advance(uint64_t size) {
+    if (!seekable_) {
+        OutputSink::advance(size);
+    }
+    if (::lseek(fd_, static_cast<off_t>(size), SEEK_CUR) < 0) {
+        throw std::runtime_error(std::string("Write failed: ") + std::strerror(errno));
+    }
+}
+
+FileSink::FileSink(const std::string& filename, size_t buffer_size)
+    : FdSink(::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666), buffer_size),
+      filename_(filename) {
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open output file: " + filename);
+    }
+}
+
+FileSink::FileSink(const std::string& filename, Mode mode, size_t buffer_size)
+    : FdSink(::open(filename.c_str(), mode == UPDATE ? O_WRONLY : O_WRONLY | O_CREAT | O_TRUNC, 0666),
+             buffer_size),
+      filename_(filename) {
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open output file: " + filename);
+    }
+}
+
+void FileSink::close() {
+    if (fd_ < 0) {
+        return;
+    }
+    try {
+        flush();
+    } catch (const std::exception&) {
+        ::close(fd_);
+        fd_ = -1;
+        throw std::runtime_error("Error writing output file: " + filename_);
+    }
+
+    // Drop any preallocated space that was not written
+    bool trimmed = true;
+    if (positional()) {
+        off_t position = ::lseek(fd_, 0, SEEK_CUR);
+        struct stat info;
+        if (position >= 0 && ::fstat(fd_, &info) == 0 && info.st_size > position) {
+            trimmed = (::ftruncate(fd_, position) == 0);
+        }
+    }
+    int result = ::close(fd_);
+    fd_ = -1;
+    if (result != 0 || !trimmed) {
+        throw std::runtime_error("Error writing output file: " + filename_);
+    }
+}
+
+StdoutSink::StdoutSink(size_t buffer_size) : FdSink(STDOUT_FILENO, buffer_size) {
+}
+
+MappedFileSink::MappedFileSink(const std::string& filename)
+    : filename_(filename), fd_(::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666)),
+      data_(nullptr), capacity_(0), used_(0) {
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open output file: " + filename);
+    }
+}
+
+void MappedFileSink::ensure(uint64_t size, bool exact) {
+    if (size <= capacity_ - used_) {
+        return;
+    }
+    if (fd_ < 0) {
+        throw std::logic_error("Output file is closed: " + filename_);
+    }
+    uint64_t capacity = grown_capacity(capacity_, used_, size, exact);
+    if (capacity > static_cast<uint64_t>(SIZE_MAX)) {
+        throw std::runtime_error("Output too large to map: " + filename_);
+    }
+
+    // Bytes already written are in the file, so the old mapping can go
+    if (data_) {
+        ::munmap(data_, static_cast<size_t>(capacity_));
+        data_ = nullptr;
+        capacity_ = 0;
+    }
+
+#ifdef __linux__
+    // Allocated blocks cannot run out later, when a store to the mapping
+    // would raise SIGBUS instead of returning an error
+    if (::fallocate(fd_, 0, 0, static_cast<off_t>(capacity)) != 0) {
+        if (errno == ENOSPC) {
+            throw std::runtime_error("Not enough space for the output: " + filename_);
+        }
+        if (::ftruncate(fd_, static_cast<off_t>(capacity)) != 0) {
+            throw std::runtime_error("Cannot resize output file: " + filename_);
+        }
+    }
+#else
+    if (::ftruncate(fd_, static_cast<off_t>(capacity)) != 0) {
+        throw std::runtime_error("Cannot resize output file: " + filename_);
+    }
+#endif
+
+    void* addr = ::mmap(nullptr, static_cast<size_t>(capacity), PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd_, 0);
+    if (addr == MAP_FAILED) {
+        throw std::runtime_error("Cannot map output file: " + filename_);
+    }
+    data_ = static_cast<char*>(addr);
+    capacity_ = capacity;
+}
+
+void MappedFileSink::close() {
+    if (fd_ < 0) {
+        return;
+    }
+    bool ok = true;
+    if (data_) {
+        ok = (::munmap(data_, static_cast<size_t>(capacity_)) == 0);
+        data_ = nullptr;
+    }
+
+    // Drop the part of the last reservation that was never written
+    ok = (::ftruncate(fd_, static_cast<off_t>(used_)) == 0) && ok;
+    ok = (::close(fd_) == 0) && ok;
+    fd_ = -1;
+    capacity_ = 0;
+    if (!ok) {
+        throw std::runtime_error("Error writing output file: " + filename_);
+    }
+}
+
+#else
+
+void FdSink::write_through(const char* data, size_t size) {
+    // No writev; send the buffered bytes and the new block one after another
+    const char* parts[2] = { buffer_.data(), data };
+    size_t lengths[2] = { used_, size };
+    for (int i = 0; i < 2; ++i) {
+        while (lengths[i] > 0) {
+            unsigned request = static_cast<unsigned>(std::min(lengths[i], size_t(1) << 30));
+            int written = ::_write(fd_, parts[i], request);
+            ++write_calls_;
+            if (written < 0) {
+                used_ = 0;
+                throw std::runtime_error(std::string("Write failed: ") + std::strerror(errno));
+            }
+            parts[i] += written;
+            lengths[i] -= static_cast<size_t>(written);
+        }
+    }
+    used_ = 0;
+}
+
+// Text mode keeps the CRLF line endings Windows tools expect
+FileSink::FileSink(const std::string& filename, size_t buffer_size)
+    : FdSink(::_open(filename.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_TEXT, 0666),
+             buffer_size),
+      filename_(filename) {
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open output file: " + filename);
+    }
+}
+
+// Not positional here, so an update can only rewrite from the start
+FileSink::FileSink(const std::string& filename, Mode mode, size_t buffer_size)
+    : FdSink(::_open(filename.c_str(),
+                     mode == UPDATE ? _O_WRONLY | _O_TEXT : _O_WRONLY | _O_CREAT | _O_TRUNC | _O_TEXT,
+                     0666),
+             buffer_size),
+      filename_(filename) {
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open output file: " + filename);
+    }
+}
+
+void FileSink::close() {
+    if (fd_ < 0) {
+        return;
+    }
+    try {
+        flush();
+    } catch (const std::exception&) {
+        ::_close(fd_);
+        fd_ = -1;
+        throw std::runtime_error("Error writing output file: " + filename_);
+    }
+    int result = ::_close(fd_);
+    fd_ = -1;
+    if (result != 0) {
+        throw std::runtime_error("Error writing output file: " + filename_);
+    }
+}
+
+StdoutSink::StdoutSink(size_t buffer_size) : FdSink(1, buffer_size) {
+}
+
+// Text mode output changes length, so there is nothing to preallocate
+// and no known offsets to write at
+void FdSink::reserve(uint64_t) {
+}
+
+void FdSink::write_at(uint64_t offset, const char* data, size_t size) {
+    OutputSink::write_at(offset, data, size);
+}
+
+void FdSink::advance(uint64_t size) {
+    OutputSink::advance(size);
+}
+
+MappedFileSink::MappedFileSink(const std::string& filename)
+    : filename_(filename),
+      fd_(::_open(filename.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_TEXT, 0666)),
+      data_(nullptr), capacity_(0), used_(0) {
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open output file: " + filename);
+    }
+}
+
+void MappedFileSink::ensure(uint64_t size, bool exact) {
+    if (size <= capacity_ - used_) {
+        return;
+    }
+    if (fd_ < 0) {
+        throw std::logic_error("Output file is closed: " + filename_);
+    }
+    uint64_t capacity = grown_capacity(capacity_, used_, size, exact);
+    if (capacity > static_cast<uint64_t>(SIZE_MAX)) {
+        throw std::runtime_error("Output too large for memory: " + filename_);
+    }
+    fallback_.resize(static_cast<size_t>(capacity));
+    data_ = fallback_.data();
+    capacity_ = capacity;
+}
+
+void MappedFileSink::close() {
+    if (fd_ < 0) {
+        return;
+    }
+    bool ok = true;
+    try {
+        // Unbuffered: the whole text goes out in large writes
+        if (used_ > 0) {
+            FdSink out(fd_, 1);
+            out.write(data_, static_cast<size_t>(used_));
+            out.flush();
+        }
+    } catch (const std::exception&) {
+        ok = false;
+    }
+    ok = (::_close(fd_) == 0) && ok;
+    fd_ = -1;
+    std::vector<char>().swap(fallback_);
+    data_ = nullptr;
+    capacity_ = 0;
+    if (!ok) {
+        throw std::runtime_error("Error writing output file: " + filename_);
+    }
+}
+
+#endif
+
+FileSink::~FileSink() {
+    try {
+        close();
+    } catch (const std::exception&) {
+        // Reported by an explicit close() only
+    }
+}
@@ -0,0 +1,333 @@
+#ifndef OUTPUT_SINK_HPP
+#define OUTPUT_SINK_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * Destination for converter output text
+ * Lets the converters write to a file, stdout or memory through one
+ * interface, with buffering chosen by the target.
+ */
+class OutputSink {
+public:
+    virtual ~OutputSink() {}
+
+    /**
+     * Append size bytes; buffered sinks may defer the actual write
+     * @throws std::runtime_error on write errors
+     */
+    virtual void write(const char* data, size_t size) = 0;
+
+    /**
+     * Push any buffered bytes to the target
+     * @throws std::runtime_error on write errors
+     */
+    virtual void flush() {}
+
+    /**
+     * Announce that exactly size more bytes are about to be written
+     * Lets the sink allocate once up front; the default ignores it.
+     * @throws std::runtime_error if the sink cannot hold that much
+     */
+    virtual void reserve(uint64_t size) { (void)size; }
+
+    /**
+     * true if write_at() and advance() are supported
+     */
+    virtual bool positional() const { return false; }
+
+    /**
+     * Write size bytes at offset bytes past the current end of the output
+     * Lets parallel encoders place chunks whose offsets are known from
+     * their encoded sizes. The end of the output stays where it is until
+     * advance() moves it. Safe to call from several threads at once for
+     * disjoint ranges; buffered sinks must be flushed first.
+     * @throws std::logic_error if the sink is not positional
+     * @throws std::runtime_error on write errors
+     */
+    virtual void write_at(uint64_t offset, const char* data, size_t size);
+
+    /**
+     * Move the end of the output past size bytes placed with write_at()
+     * or direct()
+     * @throws std::logic_error if the sink supports neither
+     */
+    virtual void advance(uint64_t size);
+
+    /**
+     * Writable storage for the next size bytes of output, if the sink
+     * keeps its output in memory (a buffer or a mapped file)
+     * Lets encoders format records straight into place, from several
+     * threads for disjoint ranges; advance() then commits them. The
+     * pointer is invalidated by the next call that writes.
+     * @return The storage, or nullptr if the sink has none
+     * @throws std::runtime_error if the sink cannot make room
+     */
+    virtual char* direct(uint64_t size) { (void)size; return nullptr; }
+
+    /**
+     * Finish the output; the default just flushes
+     * @throws std::runtime_error on write errors
+     */
+    virtual void close() { flush(); }
+};
+
+/**
+ * Output sink collecting the text in a growable string
+ * Converters reserve the exact encoded size first, so the string is
+ * allocated once however large the output is.
+ */
+class MemorySink : public OutputSink {
+public:
+    void write(const char* data, size_t size) override {
+        text_.append(data, size);
+    }
+
+    void reserve(uint64_t size) override;
+
+    const std::string& str() const { return text_; }
+
+    /**
+     * Hand the collected text over, leaving the sink empty
+     */
+    std::string release() {
+        std::string text;
+        text.swap(text_);
+        return text;
+    }
+
+private:
+    std::string text_;
+};
+
+/**
+ * Output sink writing into a fixed caller-provided buffer
+ * Nothing is allocated; a write past the end of the buffer fails.
+ */
+class BufferSink : public OutputSink {
+public:
+    BufferSink(char* buffer, size_t capacity)
+        : buffer_(buffer), capacity_(capacity), used_(0) {}
+
+    /**
+     * @throws std::length_error if the buffer is too small
+     */
+    void write(const char* data, size_t size) override;
+
+    /**
+     * @throws std::length_error if size bytes no longer fit
+     */
+    void reserve(uint64_t size) override;
+
+    bool positional() const override { return true; }
+
+    /**
+     * @throws std::length_error if the range does not fit the buffer
+     */
+    void write_at(uint64_t offset, const char* data, size_t size) override;
+
+    void advance(uint64_t size) override;
+
+    /**
+     * @throws std::length_error if size bytes no longer fit
+     */
+    char* direct(uint64_t size) override;
+
+    /**
+     * Number of bytes written so far
+     */
+    size_t size() const { return used_; }
+
+private:
+    char* buffer_;
+    size_t capacity_;
+    size_t used_;
+};
+
+/**
+ * Buffered output to a file descriptor using write(2)
+ * Small writes are gathered in a user-space buffer. A write that does not
+ * fit is sent together with the buffered bytes in a single writev(2), so
+ * large blocks are never copied into the buffer at all.
+ *
+ * On a regular file opened without O_APPEND the sink is positional
+ * (write_at() uses pwrite(2)), and reserve() preallocates the space with
+ * fallocate(2) where available, ftruncate(2) elsewhere, so multi-GB
+ * outputs are laid out once instead of growing block by block.
+ */
+class FdSink : public OutputSink {
+public:
+    /**
+     * Default user-space buffer size
+     */
+    static const size_t DEFAULT_BUFFER_SIZE = 1024 * 1024;
+
+    /**
+     * @param fd Open descriptor; the sink does not close it
+     */
+    explicit FdSink(int fd, size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+    /**
+     * Flushes what is left, ignoring errors; call flush() to see them
+     */
+    ~FdSink() override;
+
+    void write(const char* data, size_t size) override;
+    void flush() override;
+
+    /**
+     * @throws std::runtime_error if the space cannot be allocated
+     */
+    void reserve(uint64_t size) override;
+
+    bool positional() const override { return seekable_; }
+    void write_at(uint64_t offset, const char* data, size_t size) override;
+    void advance(uint64_t size) override;
+
+    /**
+     * Number of write system calls issued so far
+     */
+    uint64_t write_calls() const { return write_calls_; }
+
+protected:
+    int fd_;
+
+private:
+    FdSink(const FdSink&);
+    FdSink& operator=(const FdSink&);
+
+    std::vector<char> buffer_;
+    size_t used_;
+    std::atomic<uint64_t> write_calls_;
+    bool seekable_;
+
+    /**
+     * Write the buffered bytes followed by data, retrying short writes
+     */
+    void write_through(const char* data, size_t size);
+};
+
+/**
+ * Buffered output to a newly created (or truncated) file, or to an
+ * existing file updated in place
+ */
+class FileSink : public FdSink {
+public:
+    enum Mode {
+        CREATE,     // Create or truncate the file
+        UPDATE      // Open an existing file and keep its contents
+    };
+
+    /**
+     * Create or truncate the file
+     * @throws std::runtime_error if the file cannot be opened
+     */
+    explicit FileSink(const std::string& filename,
+                      size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+    /**
+     * Open the file as mode says
+     * In UPDATE mode output starts at offset 0 over the old contents; use
+     * write_at() and advance() to patch ranges. close() still trims the
+     * file to the end of the output.
+     * @throws std::runtime_error if the file cannot be opened
+     */
+    FileSink(const std::string& filename, Mode mode,
+             size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+    /**
+     * Flushes and closes the file, ignoring errors; call close() to see them
+     */
+    ~FileSink() override;
+
+    /**
+     * Flush and close the file
+     * @throws std::runtime_error if any write or the close fails
+     */
+    void close() override;
+
+    const std::string& filename() const { return filename_; }
+
+private:
+    std::string filename_;
+};
+
+/**
+ * Output written through a shared memory mapping of a new file
+ * reserve() sizes and maps the file up front, so encoders format records
+ * straight into the page cache with direct(): no user-space buffer, no
+ * write(2) copies, and parallel workers each fill their own range. Space
+ * is allocated with fallocate(2) where available, so a full disk is
+ * reported up front instead of faulting on a mapped page later. Writing
+ * past the mapping grows the file and maps it again.
+ * Platforms without mmap collect the text in memory and write the file
+ * on close().
+ */
+class MappedFileSink : public OutputSink {
+public:
+    /**
+     * Create or truncate the file
+     * @throws std::runtime_error if the file cannot be opened
+     */
+    explicit MappedFileSink(const std::string& filename);
+
+    /**
+     * Closes the file, ignoring errors; call close() to see them
+     */
+    ~MappedFileSink() override;
+
+    /**
+     * @throws std::runtime_error if the file cannot be grown or mapped
+     */
+    void write(const char* data, size_t size) override;
+
+    /**
+     * @throws std::runtime_error if the file cannot be grown or mapped
+     */
+    void reserve(uint64_t size) override;
+
+    /**
+     * @throws std::runtime_error if the file cannot be grown or mapped
+     */
+    char* direct(uint64_t size) override;
+
+    void advance(uint64_t size) override;
+
+    /**
+     * Unmap the file and trim it to the bytes written
+     * @throws std::runtime_error if the file cannot be written or closed
+     */
+    void close() override;
+
+    const std::string& filename() const { return filename_; }
+
+private:
+    MappedFileSink(const MappedFileSink&);
+    MappedFileSink& operator=(const MappedFileSink&);
+
+    std::string filename_;
+    int fd_;
+    char* data_;
+    uint64_t capacity_;
+    uint64_t used_;
+    std::vector<char> fallback_;
+
+    /**
+     * Make room for size more bytes, remapping if the file has to grow
+     */
+    void ensure(uint64_t size, bool exact);
+};
+
+/**
+ * Buffered output to standard output
+ */
+class StdoutSink : public FdSink {
+public:
+    explicit StdoutSink(size_t buffer_size = DEFAULT_BUFFER_SIZE);
+};
+
+#endif // OUTPUT_SINK_HPP
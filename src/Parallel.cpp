@@ -0,0 +1,76 @@
+#include "Parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Parallel {
+
+unsigned hardware_threads() {
+    unsigned count = std::thread::hardware_concurrency();
+    return count > 0 ? count : 1;
+}
+
+unsigned worker_count(size_t count, unsigned threads) {
+    if (count <= 1 || threads <= 1) {
+        return 1;
+    }
+    return static_cast<unsigned>(std::min(static_cast<size_t>(threads), count));
+}
+
+void run(size_t count, unsigned threads, const std::function<void(size_t)>& task) {
+    run_workers(count, threads, [&](size_t index, unsigned) { task(index); });
+}
+
+void run_workers(size_t count, unsigned threads,
+                 const std::function<void(size_t, unsigned)>& task) {
+    unsigned workers = worker_count(count, threads);
+    if (workers == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i, 0);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next_index(0);
+    std::atomic<bool> failed(false);
+    std::exception_ptr first_error;
+    std::mutex error_mutex;
+
+    auto worker = [&](unsigned id) {
+        while (!failed) {
+            size_t index = next_index++;
+            if (index >= count) {
+                break;
+            }
+            try {
+                task(index, id);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!first_error) {
+                    first_error = std::current_exception();
+                }
+                failed = true;
+            }
+        }
+    };
+
+    // The calling thread works too (as worker 0), so spawn one thread fewer
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (unsigned id = 1; id < workers; ++id) {
+        pool.emplace_back(worker, id);
+    }
+    worker(0);
+    for (std::thread& t : pool) {
+        t.join();
+    }
+
+    if (first_error) {
+        std::rethrow_exception(first_error);
+    }
+}
+
+} // namespace Parallel
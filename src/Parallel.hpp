@@ -0,0 +1,37 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <cstddef>
+#include <functional>
+
+namespace Parallel {
+
+/**
+ * Number of hardware threads available (at least 1)
+ */
+unsigned hardware_threads();
+
+/**
+ * Run task(index) for every index in [0, count) on up to `threads` threads
+ * Indices are handed out in ascending order; the call returns when all
+ * tasks are done. The first exception thrown by a task is rethrown here.
+ * With threads <= 1 the tasks run inline on the calling thread.
+ */
+void run(size_t count, unsigned threads, const std::function<void(size_t)>& task);
+
+/**
+ * run() that also passes the worker number, in [0, min(threads, count))
+ * Lets each worker keep its own reusable state (buffers, converters)
+ * without locking.
+ */
+void run_workers(size_t count, unsigned threads,
+                 const std::function<void(size_t, unsigned)>& task);
+
+/**
+ * Number of workers run_workers() uses for the given task count
+ */
+unsigned worker_count(size_t count, unsigned threads);
+
+} // namespace Parallel
+
+#endif // PARALLEL_HPP
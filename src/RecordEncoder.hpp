@@ -0,0 +1,315 @@
+#ifndef RECORD_ENCODER_HPP
+#define RECORD_ENCODER_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "InputSource.hpp"
+#include "OutputSink.hpp"
+#include "Parallel.hpp"
+
+/**
+ * Record encoding engine shared by the Intel HEX and S-Record converters
+ *
+ * Everything here is templated on a format policy, so chunking, streaming,
+ * in-place and parallel output are written once and compiled per format
+ * (and per address width) with the record writer inlined into the loop.
+ * A format policy provides:
+ *
+ *   typedef ... State;
+ *       Encoder position carried from block to block
+ *   size_t max_record_bytes() const;
+ *       Most data bytes one record holds
+ *   size_t record_bytes(const State& state, size_t remaining) const;
+ *       Data bytes in the next record
+ *   char* write_record(char* out, State& state, const uint8_t* data, size_t count) const;
+ *       Format the next record (and any record it needs first) with its
+ *       line terminator, advance state and return one past the end
+ *   uint64_t records_size(uint64_t size, State& state) const;
+ *       Exact text length format_records() produces for size bytes,
+ *       advancing state just as it would
+ *   size_t complete_records(size_t size, const State& state) const;
+ *       Longest prefix of size bytes that ends on a record boundary
+ *   void split(const State& state, size_t size, std::vector<size_t>& offsets) const;
+ *       Chunk start offsets for parallel formatting, ending with size
+ *   State chunk_state(const State& state, size_t offset) const;
+ *       State for formatting the chunk at offset on its own
+ */
+namespace RecordEncoder {
+
+/**
+ * Format the records for a whole block into out, which must hold
+ * records_size() characters
+ * @return One past the last character written
+ */
+template <typename Format>
+char* format_records(const Format& format,
+                     char* out,
+                     const uint8_t* data,
+                     size_t size,
+                     typename Format::State& state) {
+    size_t offset = 0;
+    while (offset < size) {
+        size_t count = format.record_bytes(state, size - offset);
+        out = format.write_record(out, state, data + offset, count);
+        offset += count;
+    }
+    return out;
+}
+
+/**
+ * Append the records for a block of input to text
+ * @param final true if this block ends the input; otherwise a trailing
+ *              partial record is left unconsumed
+ * @return Number of input bytes consumed
+ */
+template <typename Format>
+size_t format_block(const Format& format,
+                    std::string& text,
+                    const uint8_t* data,
+                    size_t size,
+                    bool final,
+                    typename Format::State& state) {
+    // A short record is only written at the very end of the input
+    if (!final) {
+        size = format.complete_records(size, state);
+    }
+
+    // The text length is known exactly, so records are formatted in place
+    typename Format::State size_state = state;
+    size_t old_size = text.size();
+    text.resize(old_size + static_cast<size_t>(format.records_size(size, size_state)));
+    format_records(format, &text[old_size], data, size, state);
+    return size;
+}
+
+/**
+ * Split a block into chunks for parallel formatting and work out where
+ * each chunk's text starts
+ * @param chunk_offsets Receives the chunk start offsets, ending with size
+ * @param text_offsets Receives the text offset of every chunk, ending
+ *                     with the text length of the whole block
+ * @return Text length of the whole block
+ */
+template <typename Format>
+uint64_t chunk_layout(const Format& format,
+                      const typename Format::State& state,
+                      size_t size,
+                      std::vector<size_t>& chunk_offsets,
+                      std::vector<uint64_t>& text_offsets) {
+    typedef typename Format::State State;
+
+    chunk_offsets.clear();
+    format.split(state, size, chunk_offsets);
+    size_t chunk_count = chunk_offsets.size() - 1;
+
+    text_offsets.assign(chunk_count + 1, 0);
+    for (size_t i = 0; i < chunk_count; ++i) {
+        State size_state = format.chunk_state(state, chunk_offsets[i]);
+        text_offsets[i + 1] = text_offsets[i] +
+            format.records_size(chunk_offsets[i + 1] - chunk_offsets[i], size_state);
+    }
+
+    State end_state = state;
+    if (text_offsets[chunk_count] != format.records_size(size, end_state)) {
+        throw std::logic_error("Encoded size does not match the computed size");
+    }
+    return text_offsets[chunk_count];
+}
+
+/**
+ * Format the listed chunks of a block on `threads` threads and write each
+ * at its text offset from chunk_layout()
+ * Chunks can be formatted on their own because every one starts from
+ * chunk_state(), so a few changed chunks can be spliced into existing
+ * output. The sink must be positional and flushed; its end is not moved.
+ */
+template <typename Format>
+void write_chunks(const Format& format,
+                  OutputSink& out,
+                  const uint8_t* data,
+                  const typename Format::State& state,
+                  const std::vector<size_t>& chunk_offsets,
+                  const std::vector<uint64_t>& text_offsets,
+                  const std::vector<size_t>& chunks,
+                  unsigned threads) {
+    typedef typename Format::State State;
+
+    std::vector<std::string> texts(Parallel::worker_count(chunks.size(), threads));
+    Parallel::run_workers(chunks.size(), threads, [&](size_t n, unsigned worker) {
+        size_t i = chunks[n];
+        State chunk = format.chunk_state(state, chunk_offsets[i]);
+        std::string& text = texts[worker];
+        text.clear();
+        format_block(format, text, data + chunk_offsets[i],
+                     chunk_offsets[i + 1] - chunk_offsets[i], true, chunk);
+        if (text.size() != text_offsets[i + 1] - text_offsets[i]) {
+            throw std::logic_error("Encoded size does not match the computed size");
+        }
+        out.write_at(text_offsets[i], text.data(), text.size());
+    });
+}
+
+/**
+ * Format a block on `threads` threads, writing chunks in order or straight
+ * to their final offsets if the sink is positional or provided direct
+ * storage (dest)
+ */
+template <typename Format>
+void write_block_parallel(const Format& format,
+                          OutputSink& out,
+                          char* dest,
+                          const uint8_t* data,
+                          size_t size,
+                          typename Format::State& state,
+                          unsigned threads) {
+    typedef typename Format::State State;
+
+    std::vector<size_t> chunk_offsets;
+    std::vector<uint64_t> text_offsets;
+    uint64_t total = chunk_layout(format, state, size, chunk_offsets, text_offsets);
+    size_t chunk_count = chunk_offsets.size() - 1;
+
+    State end_state = state;
+    format.records_size(size, end_state);
+
+    if (dest) {
+        // Every chunk's place in the output is known from its encoded size,
+        // so workers put their text straight there in any order
+        Parallel::run(chunk_count, threads, [&](size_t i) {
+            State chunk = format.chunk_state(state, chunk_offsets[i]);
+            char* begin = dest + text_offsets[i];
+            char* end = format_records(format, begin, data + chunk_offsets[i],
+                                       chunk_offsets[i + 1] - chunk_offsets[i], chunk);
+            if (static_cast<uint64_t>(end - begin) != text_offsets[i + 1] - text_offsets[i]) {
+                throw std::logic_error("Encoded size does not match the computed size");
+            }
+        });
+        out.advance(total);
+    } else if (out.positional()) {
+        out.flush();
+        std::vector<size_t> chunks(chunk_count);
+        for (size_t i = 0; i < chunk_count; ++i) {
+            chunks[i] = i;
+        }
+        write_chunks(format, out, data, state, chunk_offsets, text_offsets, chunks, threads);
+        out.advance(total);
+    } else {
+        // Format a window of chunks concurrently, then write them out in order
+        size_t window = static_cast<size_t>(threads) * 4;
+        std::vector<std::string> texts(std::min(window, chunk_count));
+
+        for (size_t first = 0; first < chunk_count; first += window) {
+            size_t batch = std::min(window, chunk_count - first);
+
+            Parallel::run(batch, threads, [&](size_t i) {
+                State chunk = format.chunk_state(state, chunk_offsets[first + i]);
+                texts[i].clear();
+                format_block(format, texts[i], data + chunk_offsets[first + i],
+                             chunk_offsets[first + i + 1] - chunk_offsets[first + i],
+                             true, chunk);
+            });
+
+            for (size_t i = 0; i < batch; ++i) {
+                out.write(texts[i].data(), texts[i].size());
+            }
+        }
+    }
+
+    // Leave the state where the sequential encoder would
+    state = end_state;
+}
+
+/**
+ * Write the records for one contiguous block of in-memory input, formatted
+ * in place when the sink provides storage, otherwise chunk_size input
+ * bytes at a time or on `threads` threads
+ */
+template <typename Format>
+void write_block(const Format& format,
+                 OutputSink& out,
+                 const uint8_t* data,
+                 size_t size,
+                 typename Format::State& state,
+                 unsigned threads,
+                 size_t chunk_size) {
+    if (size == 0) {
+        return;
+    }
+
+    // Sinks that keep the output in memory (a buffer, a mapped file) get
+    // the records formatted straight into place
+    typename Format::State end_state = state;
+    uint64_t length = format.records_size(size, end_state);
+    char* dest = out.direct(length);
+
+    if (threads > 1) {
+        write_block_parallel(format, out, dest, data, size, state, threads);
+        return;
+    }
+
+    if (dest) {
+        format_records(format, dest, data, size, state);
+        out.advance(length);
+        return;
+    }
+
+    // Format a chunk at a time to keep the text buffer bounded
+    std::string text;
+    size_t offset = 0;
+    while (offset < size) {
+        size_t slice = std::min(std::max(chunk_size, format.max_record_bytes()),
+                                size - offset);
+        bool last = (offset + slice == size);
+        offset += format_block(format, text, data + offset, slice, last, state);
+        out.write(text.data(), text.size());
+        text.clear();
+    }
+}
+
+/**
+ * Write the records for an input stream, reading chunk_size bytes at a time
+ */
+template <typename Format>
+void write_stream(const Format& format,
+                  InputSource& input,
+                  OutputSink& out,
+                  typename Format::State& state,
+                  size_t chunk_size) {
+    std::string text;
+
+    // Room for one chunk plus the partial record carried over from the last one
+    std::vector<uint8_t> buffer(chunk_size + format.max_record_bytes());
+    size_t buffered = 0;
+    bool end_of_input = false;
+
+    while (!end_of_input) {
+        // Fill the buffer, a short read alone does not mean end of input
+        while (buffered < buffer.size()) {
+            size_t count = input.read(buffer.data() + buffered, buffer.size() - buffered);
+            if (count == 0) {
+                end_of_input = true;
+                break;
+            }
+            buffered += count;
+        }
+
+        size_t consumed = format_block(format, text, buffer.data(), buffered,
+                                       end_of_input, state);
+        out.write(text.data(), text.size());
+        text.clear();
+
+        // Keep the incomplete trailing record for the next chunk
+        buffered -= consumed;
+        if (consumed > 0 && buffered > 0) {
+            std::memmove(buffer.data(), buffer.data() + consumed, buffered);
+        }
+    }
+}
+
+} // namespace RecordEncoder
+
+#endif // RECORD_ENCODER_HPP
@@ -1,10 +1,160 @@
 #include "SRecordConverter.hpp"
 #include "BinaryUtils.hpp"
+#include "RecordEncoder.hpp"
+#include "Stats.hpp"
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 
+const size_t SRecordConverter::MAX_RECORD_LENGTH;
+const size_t SRecordConverter::DEFAULT_CHUNK_SIZE;
+
+namespace {
+
+// Characters in a record besides its address and data digits: 'S', type,
+// byte count, checksum and the newline
+const uint64_t RECORD_OVERHEAD = 1 + 1 + 2 + 2 + 1;
+
+/**
+ * Encoder position carried across chunks
+ */
+struct EncodeState {
+    uint32_t current_address;
+    uint32_t record_count;
+};
+
+/**
+ * S-Record format policy for RecordEncoder, one per address width
+ * Every data record but the last holds exactly record_length bytes. The
+ * record type (S1, S2 or S3) and address width are constants here, so
+ * formatting a record takes no branches on them.
+ */
+template <int AddressBytes>
+class SRecordFormat {
+public:
+    typedef EncodeState State;
+
+    explicit SRecordFormat(size_t record_length) : record_length_(record_length) {}
+
+    size_t max_record_bytes() const { return record_length_; }
+
+    size_t record_bytes(const State&, size_t remaining) const {
+        return std::min(record_length_, remaining);
+    }
+
+    char* write_record(char* out, State& state, const uint8_t* data, size_t count) const {
+        *out++ = 'S';
+        *out++ = static_cast<char>('0' + AddressBytes - 1);
+
+        // Byte count covers address bytes, data bytes and the checksum byte
+        uint8_t byte_count = static_cast<uint8_t>(AddressBytes + count + 1);
+        out = BinaryUtils::write_hex_byte(out, byte_count);
+        uint32_t sum = byte_count;
+
+        // Address bytes (big endian)
+        for (int shift = (AddressBytes - 1) * 8; shift >= 0; shift -= 8) {
+            uint8_t addr_byte = static_cast<uint8_t>(state.current_address >> shift);
+            sum += addr_byte;
+            out = BinaryUtils::write_hex_byte(out, addr_byte);
+        }
+
+        // Data bytes, summed while they are formatted, then the checksum
+        out = BinaryUtils::bytes_to_hex_sum(data, count, out, sum);
+        out = BinaryUtils::write_hex_byte(out, static_cast<uint8_t>(~sum & 0xFF));
+        *out++ = '\n';
+
+        state.current_address += static_cast<uint32_t>(count);
+        state.record_count++;
+        return out;
+    }
+
+    uint64_t records_size(uint64_t size, State& state) const {
+        uint64_t records = (size + record_length_ - 1) / record_length_;
+        state.current_address = static_cast<uint32_t>(state.current_address + size);
+        state.record_count = static_cast<uint32_t>(state.record_count + records);
+        return 2 * size + records * (RECORD_OVERHEAD + 2 * AddressBytes);
+    }
+
+    size_t complete_records(size_t size, const State&) const {
+        return size / record_length_ * record_length_;
+    }
+
+    void split(const State&, size_t size, std::vector<size_t>& offsets) const {
+        // Whole records of about 64KB per chunk, so every chunk's addresses
+        // follow from its offset
+        size_t chunk_bytes = std::max(size_t(1), 0x10000 / record_length_) * record_length_;
+        for (size_t offset = 0; offset < size; offset += chunk_bytes) {
+            offsets.push_back(offset);
+        }
+        offsets.push_back(size);
+    }
+
+    State chunk_state(const State& state, size_t offset) const {
+        State chunk = { static_cast<uint32_t>(state.current_address + offset), 0 };
+        return chunk;
+    }
+
+private:
+    size_t record_length_;
+};
+
+/**
+ * RecordEncoder::write_block() with the format for address_size bits
+ */
+void write_block(int address_size,
+                 size_t record_length,
+                 OutputSink& out,
+                 const uint8_t* data,
+                 size_t size,
+                 EncodeState& state,
+                 unsigned threads,
+                 size_t chunk_size) {
+    switch (address_size) {
+        case 16:
+            RecordEncoder::write_block(SRecordFormat<2>(record_length), out, data, size,
+                                       state, threads, chunk_size);
+            break;
+        case 24:
+            RecordEncoder::write_block(SRecordFormat<3>(record_length), out, data, size,
+                                       state, threads, chunk_size);
+            break;
+        default:
+            RecordEncoder::write_block(SRecordFormat<4>(record_length), out, data, size,
+                                       state, threads, chunk_size);
+            break;
+    }
+}
+
+/**
+ * RecordEncoder::write_stream() with the format for address_size bits
+ */
+void write_stream(int address_size,
+                  size_t record_length,
+                  InputSource& input,
+                  OutputSink& out,
+                  EncodeState& state,
+                  size_t chunk_size) {
+    switch (address_size) {
+        case 16:
+            RecordEncoder::write_stream(SRecordFormat<2>(record_length), input, out,
+                                        state, chunk_size);
+            break;
+        case 24:
+            RecordEncoder::write_stream(SRecordFormat<3>(record_length), input, out,
+                                        state, chunk_size);
+            break;
+        default:
+            RecordEncoder::write_stream(SRecordFormat<4>(record_length), input, out,
+                                        state, chunk_size);
+            break;
+    }
+}
+
+} // namespace
+
 SRecordConverter::SRecordConverter(size_t bytes_per_line)
-    : bytes_per_line_(bytes_per_line) {
+    : bytes_per_line_(bytes_per_line), chunk_size_(DEFAULT_CHUNK_SIZE), thread_count_(1),
+      mapped_output_(false), stats_(nullptr) {
     // Reasonable limits for S-Record format
     bytes_per_line_ = std::max(size_t(1), std::min(size_t(252), bytes_per_line_));
 }
@@ -14,12 +164,91 @@ bool SRecordConverter::convert_to_srec(const std::vector<uint8_t>& binary_data,
                                       const std::string& output_file,
                                       int address_size,
                                       const std::string& header) {
-    std::ofstream out(output_file);
-    if (!out.is_open()) {
-        last_error_ = "Failed to open output file: " + output_file;
+    return convert_to_srec(binary_data.data(), binary_data.size(),
+                           start_address, output_file, address_size, header);
+}
+
+bool SRecordConverter::convert_to_srec(const uint8_t* data,
+                                      size_t size,
+                                      uint32_t start_address,
+                                      const std::string& output_file,
+                                      int address_size,
+                                      const std::string& header) {
+    std::unique_ptr<OutputSink> out;
+    return open_output(out, output_file) &&
+           convert_to_srec(data, size, start_address, *out, address_size, header) &&
+           close_output(*out, output_file);
+}
+
+bool SRecordConverter::convert_to_srec(const uint8_t* data,
+                                      size_t size,
+                                      uint32_t start_address,
+                                      OutputSink& output,
+                                      int address_size,
+                                      const std::string& header) {
+    try {
+        // Validate address size
+        if (address_size != 16 && address_size != 24 && address_size != 32) {
+            last_error_ = "Invalid address size. Must be 16, 24, or 32 bits.";
+            return false;
+        }
+
+        output.reserve(encoded_size(size, address_size, header));
+
+        std::string text;
+        format_header_record(text, header);
+
+        output.write(text.data(), text.size());
+        text.clear();
+
+        EncodeState state = { start_address, 0 };
+        write_block(address_size, get_record_length(get_data_record_type(address_size)),
+                    output, data, size, state, thread_count_, chunk_size_);
+
+        format_trailer_records(text, state.record_count, start_address, address_size);
+        output.write(text.data(), text.size());
+
+        output.flush();
+        return true;
+
+    } catch (const std::exception& e) {
+        last_error_ = "Exception during conversion: " + std::string(e.what());
         return false;
     }
+}
 
+bool SRecordConverter::convert_to_srec(const uint8_t* data,
+                                      size_t size,
+                                      uint32_t start_address,
+                                      char* buffer,
+                                      size_t capacity,
+                                      size_t& written,
+                                      int address_size,
+                                      const std::string& header) {
+    BufferSink out(buffer, capacity);
+    if (!convert_to_srec(data, size, start_address, out, address_size, header)) {
+        return false;
+    }
+    written = out.size();
+    return true;
+}
+
+bool SRecordConverter::convert_to_srec(const MemoryImage& image,
+                                      uint32_t start_address,
+                                      const std::string& output_file,
+                                      int address_size,
+                                      const std::string& header) {
+    std::unique_ptr<OutputSink> out;
+    return open_output(out, output_file) &&
+           convert_to_srec(image, start_address, *out, address_size, header) &&
+           close_output(*out, output_file);
+}
+
+bool SRecordConverter::convert_to_srec(const MemoryImage& image,
+                                      uint32_t start_address,
+                                      OutputSink& output,
+                                      int address_size,
+                                      const std::string& header) {
     try {
         // Validate address size
         if (address_size != 16 && address_size != 24 && address_size != 32) {
@@ -27,63 +256,87 @@ bool SRecordConverter::convert_to_srec(const std::vector<uint8_t>& binary_data,
             return false;
         }
 
-        // Write header record if provided
-        if (!header.empty()) {
-            std::vector<uint8_t> header_data(header.begin(), header.end());
-            std::string header_record = generate_record(S0_HEADER, 0, header_data);
-            out << header_record << std::endl;
-        }
+        output.reserve(encoded_size(image, address_size, header));
+
+        std::string text;
+        format_header_record(text, header);
+        output.write(text.data(), text.size());
+        text.clear();
 
-        // Get record types for this address size
-        RecordType data_type = get_data_record_type(address_size);
-        RecordType end_type = get_end_record_type(address_size);
-        
-        uint32_t current_address = start_address;
-        size_t data_offset = 0;
-        uint32_t record_count = 0;
-
-        // Write data records
-        while (data_offset < binary_data.size()) {
-            // Calculate bytes for this record
-            size_t bytes_remaining = binary_data.size() - data_offset;
-            size_t bytes_this_line = std::min(bytes_per_line_, bytes_remaining);
-            
-            // Account for address and checksum overhead
-            int addr_bytes = get_address_bytes(data_type);
-            size_t max_data_bytes = 255 - addr_bytes - 1; // 1 byte for checksum
-            bytes_this_line = std::min(bytes_this_line, max_data_bytes);
-
-            // Extract data for this record
-            std::vector<uint8_t> line_data(
-                binary_data.begin() + data_offset,
-                binary_data.begin() + data_offset + bytes_this_line
-            );
-
-            // Generate and write the data record
-            std::string record = generate_record(data_type, current_address, line_data);
-            out << record << std::endl;
-
-            // Update counters
-            data_offset += bytes_this_line;
-            current_address += bytes_this_line;
-            record_count++;
+        EncodeState state = { 0, 0 };
+        size_t record_length = get_record_length(get_data_record_type(address_size));
+        const MemoryImage::SegmentMap& segments = image.segments();
+        for (MemoryImage::SegmentMap::const_iterator it = segments.begin();
+             it != segments.end(); ++it) {
+            state.current_address = it->first;
+            write_block(address_size, record_length, output, it->second.data(),
+                        it->second.size(), state, thread_count_, chunk_size_);
         }
 
-        // Write record count (optional)
-        if (record_count <= 0xFFFF) {
-            std::vector<uint8_t> count_data = {
-                static_cast<uint8_t>(record_count >> 8),
-                static_cast<uint8_t>(record_count & 0xFF)
-            };
-            std::string count_record = generate_record(S5_COUNT_16, record_count, count_data);
-            out << count_record << std::endl;
+        format_trailer_records(text, state.record_count, start_address, address_size);
+        output.write(text.data(), text.size());
+
+        output.flush();
+        return true;
+
+    } catch (const std::exception& e) {
+        last_error_ = "Exception during conversion: " + std::string(e.what());
+        return false;
+    }
+}
+
+bool SRecordConverter::convert_to_srec(const MemoryImage& image,
+                                      uint32_t start_address,
+                                      char* buffer,
+                                      size_t capacity,
+                                      size_t& written,
+                                      int address_size,
+                                      const std::string& header) {
+    BufferSink out(buffer, capacity);
+    if (!convert_to_srec(image, start_address, out, address_size, header)) {
+        return false;
+    }
+    written = out.size();
+    return true;
+}
+
+bool SRecordConverter::convert_to_srec(InputSource& input,
+                                      uint32_t start_address,
+                                      const std::string& output_file,
+                                      int address_size,
+                                      const std::string& header) {
+    std::unique_ptr<OutputSink> out;
+    return open_output(out, output_file) &&
+           convert_to_srec(input, start_address, *out, address_size, header) &&
+           close_output(*out, output_file);
+}
+
+bool SRecordConverter::convert_to_srec(InputSource& input,
+                                      uint32_t start_address,
+                                      OutputSink& output,
+                                      int address_size,
+                                      const std::string& header) {
+    try {
+        // Validate address size
+        if (address_size != 16 && address_size != 24 && address_size != 32) {
+            last_error_ = "Invalid address size. Must be 16, 24, or 32 bits.";
+            return false;
         }
 
-        // Write end record
-        std::string end_record = generate_record(end_type, start_address, {});
-        out << end_record << std::endl;
+        std::string text;
+        format_header_record(text, header);
 
-        out.close();
+        output.write(text.data(), text.size());
+        text.clear();
+
+        EncodeState state = { start_address, 0 };
+        write_stream(address_size, get_record_length(get_data_record_type(address_size)),
+                     input, output, state, chunk_size_);
+
+        format_trailer_records(text, state.record_count, start_address, address_size);
+        output.write(text.data(), text.size());
+
+        output.flush();
         return true;
 
     } catch (const std::exception& e) {
@@ -92,68 +345,167 @@ bool SRecordConverter::convert_to_srec(const std::vector<uint8_t>& binary_data,
     }
 }
 
-std::string SRecordConverter::generate_record(RecordType type,
-                                             uint32_t address,
-                                             const std::vector<uint8_t>& data) {
-    std::string record = "S";
-    
-    // Record type
-    record += std::to_string(static_cast<int>(type));
-    
-    // Calculate byte count (address bytes + data bytes + checksum byte)
-    int addr_bytes = get_address_bytes(type);
-    uint8_t byte_count = static_cast<uint8_t>(addr_bytes + data.size() + 1);
-    record += BinaryUtils::byte_to_hex(byte_count);
-    
-    // Address bytes (big endian)
-    if (addr_bytes >= 2) {
-        record += BinaryUtils::byte_to_hex(static_cast<uint8_t>(address >> 8));
-        record += BinaryUtils::byte_to_hex(static_cast<uint8_t>(address & 0xFF));
+uint64_t SRecordConverter::encoded_size(uint64_t size,
+                                       int address_size,
+                                       const std::string& header) const {
+    if (address_size != 16 && address_size != 24 && address_size != 32) {
+        return 0;
     }
-    if (addr_bytes >= 3) {
-        record += BinaryUtils::byte_to_hex(static_cast<uint8_t>(address >> 16));
+
+    RecordType data_type = get_data_record_type(address_size);
+    uint64_t record_length = get_record_length(data_type);
+    uint64_t records = (size + record_length - 1) / record_length;
+    return data_records_size(size, data_type) + framing_size(records, address_size, header);
+}
+
+uint64_t SRecordConverter::encoded_size(const MemoryImage& image,
+                                       int address_size,
+                                       const std::string& header) const {
+    if (address_size != 16 && address_size != 24 && address_size != 32) {
+        return 0;
     }
-    if (addr_bytes >= 4) {
-        record += BinaryUtils::byte_to_hex(static_cast<uint8_t>(address >> 24));
+
+    // Each segment ends in its own short record
+    RecordType data_type = get_data_record_type(address_size);
+    uint64_t record_length = get_record_length(data_type);
+    uint64_t total = 0;
+    uint64_t records = 0;
+    const MemoryImage::SegmentMap& segments = image.segments();
+    for (MemoryImage::SegmentMap::const_iterator it = segments.begin();
+         it != segments.end(); ++it) {
+        total += data_records_size(it->second.size(), data_type);
+        records += (it->second.size() + record_length - 1) / record_length;
     }
-    
-    // Data bytes
-    for (uint8_t byte : data) {
-        record += BinaryUtils::byte_to_hex(byte);
+
+    return total + framing_size(records, address_size, header);
+}
+
+bool SRecordConverter::open_output(std::unique_ptr<OutputSink>& out, const std::string& output_file) {
+    try {
+        StageTimer timer(stats_, ConversionStats::STAGE_WRITE);
+        if (mapped_output_) {
+            out.reset(new MappedFileSink(output_file));
+        } else {
+            out.reset(new FileSink(output_file));
+        }
+        if (stats_) {
+            out.reset(new StatsSink(std::move(out), *stats_));
+        }
+        return true;
+    } catch (const std::exception&) {
+        last_error_ = "Failed to open output file: " + output_file;
+        return false;
     }
-    
-    // Checksum
-    uint8_t checksum = calculate_checksum(byte_count, address, addr_bytes, data);
-    record += BinaryUtils::byte_to_hex(checksum);
-    
-    return record;
 }
 
-uint8_t SRecordConverter::calculate_checksum(uint8_t byte_count,
-                                            uint32_t address,
-                                            int address_bytes,
-                                            const std::vector<uint8_t>& data) {
+bool SRecordConverter::close_output(OutputSink& out, const std::string& output_file) {
+    try {
+        out.close();
+        return true;
+    } catch (const std::exception&) {
+        last_error_ = "Error writing output file: " + output_file;
+        return false;
+    }
+}
+
+void SRecordConverter::format_header_record(std::string& text, const std::string& header) const {
+    // Write header record if provided, clipped to what one record can hold
+    if (!header.empty()) {
+        char line[MAX_RECORD_LENGTH + 1];
+        size_t header_size = std::min(header.size(), size_t(252));
+        size_t line_length = write_record(line, S0_HEADER, 0,
+                                          reinterpret_cast<const uint8_t*>(header.data()),
+                                          header_size);
+        line[line_length++] = '\n';
+        text.append(line, line_length);
+    }
+}
+
+void SRecordConverter::format_trailer_records(std::string& text,
+                                              uint32_t record_count,
+                                              uint32_t start_address,
+                                              int address_size) const {
+    char line[MAX_RECORD_LENGTH + 1];
+    size_t line_length;
+
+    // Record count goes in the address field: S5 up to 16 bits, S6 up to 24
+    if (record_count <= 0xFFFFFF) {
+        RecordType count_type = (record_count <= 0xFFFF) ? S5_COUNT_16 : S6_COUNT_24;
+        line_length = write_record(line, count_type, record_count, nullptr, 0);
+        line[line_length++] = '\n';
+        text.append(line, line_length);
+    }
+
+    // End record carries the start address
+    line_length = write_record(line, get_end_record_type(address_size),
+                               start_address, nullptr, 0);
+    line[line_length++] = '\n';
+    text.append(line, line_length);
+}
+
+size_t SRecordConverter::write_record(char* out,
+                                     RecordType type,
+                                     uint32_t address,
+                                     const uint8_t* data,
+                                     size_t size) {
+    char* p = out;
+    *p++ = 'S';
+    *p++ = static_cast<char>('0' + static_cast<int>(type));
+
+    // Byte count covers address bytes, data bytes and the checksum byte
+    int addr_bytes = get_address_bytes(type);
+    uint8_t byte_count = static_cast<uint8_t>(addr_bytes + size + 1);
+    p = BinaryUtils::write_hex_byte(p, byte_count);
     uint32_t sum = byte_count;
-    
-    // Add address bytes
-    if (address_bytes >= 2) {
-        sum += (address >> 8) & 0xFF;
-        sum += address & 0xFF;
-    }
-    if (address_bytes >= 3) {
-        sum += (address >> 16) & 0xFF;
-    }
-    if (address_bytes >= 4) {
-        sum += (address >> 24) & 0xFF;
-    }
-    
-    // Add data bytes
-    for (uint8_t byte : data) {
-        sum += byte;
-    }
-    
-    // Return one's complement of least significant byte
-    return static_cast<uint8_t>(~sum & 0xFF);
+
+    // Address bytes (big endian)
+    for (int shift = (addr_bytes - 1) * 8; shift >= 0; shift -= 8) {
+        uint8_t addr_byte = static_cast<uint8_t>(address >> shift);
+        sum += addr_byte;
+        p = BinaryUtils::write_hex_byte(p, addr_byte);
+    }
+
+    // Data bytes, summed while they are formatted
+    p = BinaryUtils::bytes_to_hex_sum(data, size, p, sum);
+
+    // Checksum (one's complement)
+    p = BinaryUtils::write_hex_byte(p, static_cast<uint8_t>(~sum & 0xFF));
+
+    return static_cast<size_t>(p - out);
+}
+
+uint64_t SRecordConverter::data_records_size(uint64_t size, RecordType data_type) const {
+    // Every record but the last is full length
+    uint64_t record_length = get_record_length(data_type);
+    uint64_t records = (size + record_length - 1) / record_length;
+    return 2 * size + records * (RECORD_OVERHEAD + 2 * get_address_bytes(data_type));
+}
+
+uint64_t SRecordConverter::framing_size(uint64_t record_count,
+                                       int address_size,
+                                       const std::string& header) const {
+    uint64_t total = 0;
+
+    // S0 with a 16-bit address, as clipped by format_header_record()
+    if (!header.empty()) {
+        total += RECORD_OVERHEAD + 4 + 2 * std::min(header.size(), size_t(252));
+    }
+
+    // S5 or S6, left out when the count does not fit in 24 bits
+    if (record_count <= 0xFFFF) {
+        total += RECORD_OVERHEAD + 4;
+    } else if (record_count <= 0xFFFFFF) {
+        total += RECORD_OVERHEAD + 6;
+    }
+
+    // End record with the start address
+    return total + RECORD_OVERHEAD + 2 * get_address_bytes(get_end_record_type(address_size));
+}
+
+size_t SRecordConverter::get_record_length(RecordType data_type) const {
+    // Account for address and checksum overhead
+    size_t max_data_bytes = 255 - get_address_bytes(data_type) - 1;
+    return std::min(bytes_per_line_, max_data_bytes);
 }
 
 int SRecordConverter::get_address_bytes(RecordType type) {
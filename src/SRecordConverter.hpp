@@ -2,9 +2,15 @@
 #define SRECORD_CONVERTER_HPP
 
 #include <cstdint>
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <vector>
-#include <fstream>
+#include "InputSource.hpp"
+#include "MemoryImage.hpp"
+#include "OutputSink.hpp"
+
+class ConversionStats;
 
 /**
  * Motorola S-Record format converter
@@ -25,6 +31,16 @@ public:
         S9_END_16 = 9           // End record with 16-bit address
     };
 
+    /**
+     * Longest record text (byte count of 255), excluding the line terminator
+     */
+    static const size_t MAX_RECORD_LENGTH = 2 + 2 * (1 + 255);
+
+    /**
+     * Default number of input bytes pulled per chunk when streaming
+     */
+    static const size_t DEFAULT_CHUNK_SIZE = 1024 * 1024;
+
     /**
      * Constructor
      * @param bytes_per_line Number of data bytes per line
@@ -46,6 +62,170 @@ public:
                         int address_size = 32,
                         const std::string& header = "");
 
+    /**
+     * Convert a binary data view to Motorola S-Record format
+     * The data is read in place (e.g. from a memory-mapped file), never copied.
+     * @param data Pointer to the input bytes
+     * @param size Number of input bytes
+     * @param start_address Starting address for the data
+     * @param output_file Output file path
+     * @param address_size Address size (16, 24, or 32 bits)
+     * @param header Optional header string
+     * @return true on success, false on error
+     */
+    bool convert_to_srec(const uint8_t* data,
+                        size_t size,
+                        uint32_t start_address,
+                        const std::string& output_file,
+                        int address_size = 32,
+                        const std::string& header = "");
+
+    /**
+     * As above, writing the records to an output sink instead of a file
+     * The sink is flushed on success.
+     */
+    bool convert_to_srec(const uint8_t* data,
+                        size_t size,
+                        uint32_t start_address,
+                        OutputSink& output,
+                        int address_size = 32,
+                        const std::string& header = "");
+
+    /**
+     * As above, writing the records into a caller-provided buffer
+     * Size the buffer with encoded_size(); no memory is allocated for the text.
+     * @param buffer Destination for the record text
+     * @param capacity Size of buffer in bytes
+     * @param written Set to the length of the text on success
+     * @return true on success, false on error (including a buffer that is too small)
+     */
+    bool convert_to_srec(const uint8_t* data,
+                        size_t size,
+                        uint32_t start_address,
+                        char* buffer,
+                        size_t capacity,
+                        size_t& written,
+                        int address_size = 32,
+                        const std::string& header = "");
+
+    /**
+     * Convert a stream of binary data to Motorola S-Record format
+     * Input is pulled in chunks, so memory use is bounded by the chunk size.
+     * Produces exactly the same records as the in-memory overload.
+     * @param input Source of binary data
+     * @param start_address Starting address for the data
+     * @param output_file Output file path
+     * @param address_size Address size (16, 24, or 32 bits)
+     * @param header Optional header string
+     * @return true on success, false on error
+     */
+    bool convert_to_srec(InputSource& input,
+                        uint32_t start_address,
+                        const std::string& output_file,
+                        int address_size = 32,
+                        const std::string& header = "");
+
+    /**
+     * As above, writing the records to an output sink instead of a file
+     * The sink is flushed on success.
+     */
+    bool convert_to_srec(InputSource& input,
+                        uint32_t start_address,
+                        OutputSink& output,
+                        int address_size = 32,
+                        const std::string& header = "");
+
+    /**
+     * Convert a sparse memory image to Motorola S-Record format
+     * Only populated segments produce data records, so gaps cost nothing.
+     * @param image Input segments (views are read in place)
+     * @param start_address Execution start address for the end record
+     * @param output_file Output file path
+     * @param address_size Address size (16, 24, or 32 bits)
+     * @param header Optional header string
+     * @return true on success, false on error
+     */
+    bool convert_to_srec(const MemoryImage& image,
+                        uint32_t start_address,
+                        const std::string& output_file,
+                        int address_size = 32,
+                        const std::string& header = "");
+
+    /**
+     * As above, writing the records to an output sink instead of a file
+     * The sink is flushed on success.
+     */
+    bool convert_to_srec(const MemoryImage& image,
+                        uint32_t start_address,
+                        OutputSink& output,
+                        int address_size = 32,
+                        const std::string& header = "");
+
+    /**
+     * As above, writing the records into a caller-provided buffer
+     * @param written Set to the length of the text on success
+     * @return true on success, false on error (including a buffer that is too small)
+     */
+    bool convert_to_srec(const MemoryImage& image,
+                        uint32_t start_address,
+                        char* buffer,
+                        size_t capacity,
+                        size_t& written,
+                        int address_size = 32,
+                        const std::string& header = "");
+
+    /**
+     * Exact length of the text convert_to_srec() produces for size bytes,
+     * worked out from the record layout alone
+     * Lets callers allocate the output once; the sink-based overloads
+     * pass it to OutputSink::reserve() themselves.
+     * @return The length, or 0 if address_size is not 16, 24 or 32
+     */
+    uint64_t encoded_size(uint64_t size,
+                          int address_size = 32,
+                          const std::string& header = "") const;
+
+    /**
+     * Exact length of the text convert_to_srec() produces for an image
+     * @return The length, or 0 if address_size is not 16, 24 or 32
+     */
+    uint64_t encoded_size(const MemoryImage& image,
+                          int address_size = 32,
+                          const std::string& header = "") const;
+
+    /**
+     * Set the chunk size used when streaming from an InputSource
+     */
+    void set_chunk_size(size_t chunk_size) {
+        chunk_size_ = std::max(size_t(1), chunk_size);
+    }
+
+    /**
+     * Set the number of threads used to format in-memory input
+     * With more than one thread each worker formats a precomputed range of
+     * data records; the output is byte-identical to the single-threaded result.
+     */
+    void set_thread_count(unsigned thread_count) {
+        thread_count_ = std::max(1u, thread_count);
+    }
+
+    /**
+     * Write output files through a shared memory mapping (MappedFileSink)
+     * Records are then formatted straight into the file's pages by every
+     * thread, which pays off for multi-GB outputs on fast local storage.
+     */
+    void set_mapped_output(bool mapped_output) {
+        mapped_output_ = mapped_output;
+    }
+
+    /**
+     * Time and count the output of path-based conversions into stats
+     * (--stats); null turns it off again. The caller keeps ownership.
+     */
+    void set_stats(ConversionStats* stats) {
+        stats_ = stats;
+    }
+
     /**
      * Set bytes per line for output formatting
      */
@@ -58,39 +238,86 @@ public:
      */
     const std::string& get_last_error() const { return last_error_; }
 
+    /**
+     * Format a single S-Record into a caller-provided buffer.
+     * The checksum is accumulated in the same pass as the hex digits.
+     * @param out Destination, at least MAX_RECORD_LENGTH characters
+     * @param address Address field (the record count for S5/S6)
+     * @param data Data bytes (may be null when size is 0)
+     * @param size Number of data bytes; address bytes + size must not exceed 254
+     * @return Number of characters written (no line terminator)
+     */
+    static size_t write_record(char* out,
+                               RecordType type,
+                               uint32_t address,
+                               const uint8_t* data,
+                               size_t size);
+
 private:
+    /**
+     * Create the output file for a path-based conversion
+     * @return false (with last_error_ set) if it cannot be opened
+     */
+    bool open_output(std::unique_ptr<OutputSink>& out, const std::string& output_file);
+
+    /**
+     * Close a path-based conversion's output file
+     * @return false (with last_error_ set) if a write or the close failed
+     */
+    bool close_output(OutputSink& out, const std::string& output_file);
+
     size_t bytes_per_line_;
+    size_t chunk_size_;
+    unsigned thread_count_;
+    bool mapped_output_;
+    ConversionStats* stats_;
     std::string last_error_;
 
     /**
-     * Generate a single S-Record
+     * Append the S0 header record to text (nothing if header is empty)
      */
-    std::string generate_record(RecordType type,
-                               uint32_t address,
-                               const std::vector<uint8_t>& data);
+    void format_header_record(std::string& text, const std::string& header) const;
+
+    /**
+     * Append the S5/S6 record count and the end record to text
+     */
+    void format_trailer_records(std::string& text,
+                                uint32_t record_count,
+                                uint32_t start_address,
+                                int address_size) const;
+
+    /**
+     * Length of the data records for size contiguous bytes
+     */
+    uint64_t data_records_size(uint64_t size, RecordType data_type) const;
+
+    /**
+     * Length of the header, count and end records around record_count
+     * data records
+     */
+    uint64_t framing_size(uint64_t record_count,
+                          int address_size,
+                          const std::string& header) const;
 
     /**
-     * Calculate S-Record checksum
+     * Number of data bytes in every full record of the given type
      */
-    uint8_t calculate_checksum(uint8_t byte_count,
-                              uint32_t address,
-                              int address_bytes,
-                              const std::vector<uint8_t>& data);
+    size_t get_record_length(RecordType data_type) const;
 
     /**
      * Get number of address bytes for record type
      */
-    int get_address_bytes(RecordType type);
+    static int get_address_bytes(RecordType type);
 
     /**
      * Get data record type based on address size
      */
-    RecordType get_data_record_type(int address_size);
+    static RecordType get_data_record_type(int address_size);
 
     /**
      * Get end record type based on address size
      */
-    RecordType get_end_record_type(int address_size);
+    static RecordType get_end_record_type(int address_size);
 };
 
 #endif // SRECORD_CONVERTER_HPP
\ No newline at end of file
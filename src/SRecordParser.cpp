@@ -0,0 +1,127 @@
+#include "SRecordParser.hpp"
+#include "SRecordConverter.hpp"
+#include "BinaryUtils.hpp"
+#include <algorithm>
+
+SRecordParser::SRecordParser()
+    : start_address_(0), address_size_(0), record_count_(0) {
+}
+
+bool SRecordParser::parse(const char* text, size_t size, MemoryImage& image) {
+    // Address field width for S0..S9 (S4 is reserved)
+    static const int address_bytes[10] = { 2, 2, 3, 4, 0, 2, 3, 4, 3, 2 };
+
+    size_t line = 0;
+    size_t pos = 0;
+    bool end_record = false;
+
+    header_.clear();
+    start_address_ = 0;
+    address_size_ = 0;
+    record_count_ = 0;
+
+    while (pos < size && !end_record) {
+        // Skip line terminators and blank lines
+        char c = text[pos];
+        if (c == '\n' || c == '\r' || c == ' ' || c == '\t') {
+            if (c == '\n') {
+                ++line;
+            }
+            ++pos;
+            continue;
+        }
+        if (c != 'S') {
+            return fail(line, "Expected 'S' at start of record");
+        }
+
+        // Header: record type digit and byte count
+        uint8_t byte_count;
+        if (size - pos < 4 || !BinaryUtils::hex_to_bytes(text + pos + 2, 1, &byte_count)) {
+            return fail(line, "Malformed record header");
+        }
+        int type = text[pos + 1] - '0';
+        if (type < 0 || type > 9 || address_bytes[type] == 0) {
+            return fail(line, "Unknown record type");
+        }
+        int addr_bytes = address_bytes[type];
+        if (byte_count < addr_bytes + 1) {
+            return fail(line, "Byte count too small for record type");
+        }
+
+        size_t record_length = 4 + 2 * static_cast<size_t>(byte_count);
+        if (size - pos < record_length) {
+            return fail(line, "Truncated record");
+        }
+
+        // Address (big endian) and checksum are decoded up front
+        uint8_t addr[4];
+        uint8_t checksum;
+        const char* data_text = text + pos + 4 + 2 * addr_bytes;
+        size_t data_count = byte_count - addr_bytes - 1;
+        if (!BinaryUtils::hex_to_bytes(text + pos + 4, addr_bytes, addr) ||
+            !BinaryUtils::hex_to_bytes(data_text + 2 * data_count, 1, &checksum)) {
+            return fail(line, "Invalid hex digit in address or checksum");
+        }
+        uint32_t address = 0;
+        uint32_t sum = byte_count + checksum;
+        for (int i = 0; i < addr_bytes; ++i) {
+            address = (address << 8) | addr[i];
+            sum += addr[i];
+        }
+
+        // Data bytes: data records decode straight into the image
+        uint8_t buffer[255];
+        uint8_t* data = buffer;
+        if (type >= SRecordConverter::S1_DATA_16 && type <= SRecordConverter::S3_DATA_32) {
+            if (address + static_cast<uint64_t>(data_count) > MemoryImage::ADDRESS_LIMIT) {
+                return fail(line, "Data record runs past the 32-bit address space");
+            }
+            data = image.allocate(address, data_count);
+        }
+        if (!BinaryUtils::hex_to_bytes(data_text, data_count, data)) {
+            return fail(line, "Invalid hex digit in data");
+        }
+        sum += BinaryUtils::byte_sum(data, data_count);
+        if ((sum & 0xFF) != 0xFF) {
+            return fail(line, "Checksum mismatch");
+        }
+
+        switch (type) {
+            case SRecordConverter::S0_HEADER:
+                header_.assign(reinterpret_cast<const char*>(data), data_count);
+                break;
+            case SRecordConverter::S1_DATA_16:
+            case SRecordConverter::S2_DATA_24:
+            case SRecordConverter::S3_DATA_32:
+                address_size_ = std::max(address_size_, 8 * addr_bytes);
+                ++record_count_;
+                break;
+            case SRecordConverter::S5_COUNT_16:
+            case SRecordConverter::S6_COUNT_24:
+                // Counts the data records that precede it
+                if (address != record_count_) {
+                    return fail(line, "Record count mismatch: file says " +
+                                std::to_string(address) + ", found " +
+                                std::to_string(record_count_));
+                }
+                break;
+            default:
+                // S7/S8/S9 end record carries the start address
+                start_address_ = address;
+                end_record = true;
+                break;
+        }
+
+        pos += record_length;
+    }
+
+    if (!end_record) {
+        return fail(line, "Missing end record");
+    }
+    return true;
+}
+
+bool SRecordParser::fail(size_t line, const std::string& message) {
+    last_error_ = "Line " + std::to_string(line + 1) + ": " + message;
+    return false;
+}
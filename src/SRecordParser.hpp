@@ -0,0 +1,68 @@
+#ifndef SRECORD_PARSER_HPP
+#define SRECORD_PARSER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "MemoryImage.hpp"
+
+/**
+ * Motorola S-Record file format parser
+ * Decodes S0-S9 records into a sparse memory image, verifying every record
+ * checksum and the S5/S6 record count. The reverse of SRecordConverter.
+ */
+class SRecordParser {
+public:
+    SRecordParser();
+
+    /**
+     * Decode S-Record text into image
+     * Records are parsed in place from the buffer (e.g. a memory-mapped
+     * file) and data bytes are decoded straight into the image.
+     * @param text S-Record text
+     * @param size Text length in bytes
+     * @param image Destination; existing contents are overwritten where
+     *              records overlap them
+     * @return true on success, false on error (see get_last_error())
+     */
+    bool parse(const char* text, size_t size, MemoryImage& image);
+
+    /**
+     * Contents of the S0 header record (empty if there was none)
+     */
+    const std::string& get_header() const { return header_; }
+
+    /**
+     * Start address from the S7/S8/S9 end record
+     */
+    uint32_t get_start_address() const { return start_address_; }
+
+    /**
+     * Address width in bits of the data records (0 if there were none)
+     */
+    int get_address_size() const { return address_size_; }
+
+    /**
+     * Number of S1/S2/S3 data records decoded by the last parse
+     */
+    uint32_t get_record_count() const { return record_count_; }
+
+    /**
+     * Get the last error message
+     */
+    const std::string& get_last_error() const { return last_error_; }
+
+private:
+    std::string last_error_;
+    std::string header_;
+    uint32_t start_address_;
+    int address_size_;
+    uint32_t record_count_;
+
+    /**
+     * Record an error for the given line
+     */
+    bool fail(size_t line, const std::string& message);
+};
+
+#endif // SRECORD_PARSER_HPP
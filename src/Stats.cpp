@@ -0,0 +1,191 @@
+#include "Stats.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <ostream>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+const char* const STAGE_NAMES[ConversionStats::STAGE_COUNT] = {
+    "read", "checksum", "encode", "write"
+};
+
+uint64_t count_lines(const char* data, size_t size) {
+    return static_cast<uint64_t>(std::count(data, data + size, '\n'));
+}
+
+} // namespace
+
+ConversionStats::ConversionStats()
+    : input_bytes_(0), output_bytes_(0), records_(0) {
+    for (int i = 0; i < STAGE_COUNT; ++i) {
+        nanoseconds_[i] = 0;
+    }
+}
+
+void ConversionStats::add_time(Stage stage, double seconds) {
+    if (seconds > 0) {
+        nanoseconds_[stage] += static_cast<uint64_t>(seconds * 1e9);
+    }
+}
+
+double ConversionStats::get_time(Stage stage) const {
+    return nanoseconds_[stage] / 1e9;
+}
+
+double ConversionStats::total_time() const {
+    double total = 0;
+    for (int i = 0; i < STAGE_COUNT; ++i) {
+        total += get_time(static_cast<Stage>(i));
+    }
+    return total;
+}
+
+double ConversionStats::now() {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ConversionStats::print(std::ostream& out, bool json, double wall_seconds) const {
+    double rate = wall_seconds > 0 ? input_bytes_ / wall_seconds / 1e6 : 0;
+    uint64_t rss = peak_rss_bytes();
+
+    std::ios_base::fmtflags flags = out.flags();
+    out << std::fixed;
+    if (json) {
+        out << "{";
+        for (int i = 0; i < STAGE_COUNT; ++i) {
+            out << "\"" << STAGE_NAMES[i] << "_seconds\": " << std::setprecision(6)
+                << get_time(static_cast<Stage>(i)) << ", ";
+        }
+        out << "\"total_seconds\": " << wall_seconds
+            << ", \"input_bytes\": " << input_bytes_
+            << ", \"output_bytes\": " << output_bytes_
+            << ", \"records\": " << records_
+            << ", \"mb_per_second\": " << std::setprecision(1) << rate
+            << ", \"peak_rss_bytes\": " << rss << "}" << std::endl;
+    } else {
+        out << "Stats:\n";
+        for (int i = 0; i < STAGE_COUNT; ++i) {
+            out << "  " << std::left << std::setw(10) << STAGE_NAMES[i] << std::right
+                << std::setprecision(3) << std::setw(10) << get_time(static_cast<Stage>(i))
+                << " s\n";
+        }
+        out << "  " << std::left << std::setw(10) << "total" << std::right
+            << std::setprecision(3) << std::setw(10) << wall_seconds << " s\n";
+        out << "  Input:    " << input_bytes_ << " bytes (" << std::setprecision(1)
+            << rate << " MB/s)\n";
+        out << "  Output:   " << output_bytes_ << " bytes\n";
+        out << "  Records:  " << records_ << "\n";
+        out << "  Peak RSS: ";
+        if (rss > 0) {
+            out << (rss / 1024) << " KB" << std::endl;
+        } else {
+            out << "unknown" << std::endl;
+        }
+    }
+    out.flags(flags);
+}
+
+StageTimer::StageTimer(ConversionStats* stats, ConversionStats::Stage stage)
+    : stats_(stats), stage_(stage), start_(0), booked_(0) {
+    if (stats_) {
+        start_ = ConversionStats::now();
+        booked_ = stats_->total_time();
+    }
+}
+
+StageTimer::~StageTimer() {
+    stop();
+}
+
+void StageTimer::stop() {
+    if (stats_) {
+        double elapsed = ConversionStats::now() - start_;
+        double nested = stats_->total_time() - booked_;
+        stats_->add_time(stage_, elapsed - nested);
+        stats_ = nullptr;
+    }
+}
+
+StatsSink::StatsSink(std::unique_ptr<OutputSink> target, ConversionStats& stats)
+    : target_(std::move(target)), stats_(stats), direct_(nullptr) {
+}
+
+void StatsSink::write(const char* data, size_t size) {
+    StageTimer timer(&stats_, ConversionStats::STAGE_WRITE);
+    target_->write(data, size);
+    stats_.add_output_bytes(size);
+    stats_.add_records(count_lines(data, size));
+}
+
+void StatsSink::flush() {
+    StageTimer timer(&stats_, ConversionStats::STAGE_WRITE);
+    target_->flush();
+}
+
+void StatsSink::reserve(uint64_t size) {
+    StageTimer timer(&stats_, ConversionStats::STAGE_WRITE);
+    target_->reserve(size);
+}
+
+void StatsSink::write_at(uint64_t offset, const char* data, size_t size) {
+    target_->write_at(offset, data, size);
+    stats_.add_output_bytes(size);
+    stats_.add_records(count_lines(data, size));
+}
+
+void StatsSink::advance(uint64_t size) {
+    // Text formatted in place is only complete once it is committed
+    if (direct_) {
+        stats_.add_output_bytes(size);
+        stats_.add_records(count_lines(direct_, static_cast<size_t>(size)));
+        direct_ = nullptr;
+    }
+    target_->advance(size);
+}
+
+char* StatsSink::direct(uint64_t size) {
+    StageTimer timer(&stats_, ConversionStats::STAGE_WRITE);
+    direct_ = target_->direct(size);
+    return direct_;
+}
+
+void StatsSink::close() {
+    StageTimer timer(&stats_, ConversionStats::STAGE_WRITE);
+    target_->close();
+}
+
+size_t StatsInputSource::read(uint8_t* buffer, size_t size) {
+    StageTimer timer(&stats_, ConversionStats::STAGE_READ);
+    size_t count = source_.read(buffer, size);
+    stats_.add_input_bytes(count);
+    return count;
+}
+
+#ifndef _WIN32
+
+uint64_t peak_rss_bytes() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    // Reported in bytes on macOS, kilobytes elsewhere
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+#else
+
+uint64_t peak_rss_bytes() {
+    return 0;
+}
+
+#endif
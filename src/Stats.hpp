@@ -0,0 +1,136 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
+#include "InputSource.hpp"
+#include "OutputSink.hpp"
+
+/**
+ * Per-stage wall time and counters for a conversion (--stats)
+ * Nothing is measured unless a ConversionStats is handed out, so a run
+ * without --stats pays a null pointer check per stage at most. Counters
+ * are atomic; times are booked by the thread driving the conversion.
+ */
+class ConversionStats {
+public:
+    enum Stage {
+        STAGE_READ,         // Opening, mapping and reading the input
+        STAGE_CHECKSUM,     // Computing and patching an embedded checksum
+        STAGE_ENCODE,       // Formatting records
+        STAGE_WRITE,        // Writing, flushing and closing the output
+        STAGE_COUNT
+    };
+
+    ConversionStats();
+
+    void add_time(Stage stage, double seconds);
+    double get_time(Stage stage) const;
+
+    /**
+     * Sum of all stage times
+     */
+    double total_time() const;
+
+    void add_input_bytes(uint64_t count) { input_bytes_ += count; }
+    void add_output_bytes(uint64_t count) { output_bytes_ += count; }
+    void add_records(uint64_t count) { records_ += count; }
+
+    uint64_t get_input_bytes() const { return input_bytes_; }
+    uint64_t get_output_bytes() const { return output_bytes_; }
+    uint64_t get_records() const { return records_; }
+
+    /**
+     * Monotonic wall clock in seconds
+     */
+    static double now();
+
+    /**
+     * Print the report, as aligned text or as a single JSON object
+     * @param wall_seconds Elapsed time of the whole run
+     */
+    void print(std::ostream& out, bool json, double wall_seconds) const;
+
+private:
+    std::atomic<uint64_t> nanoseconds_[STAGE_COUNT];
+    std::atomic<uint64_t> input_bytes_;
+    std::atomic<uint64_t> output_bytes_;
+    std::atomic<uint64_t> records_;
+};
+
+/**
+ * Books the time between construction and destruction to a stage
+ * Time booked to other stages in between (by nested timers or wrapped
+ * sinks) is left out, so stages never count the same time twice.
+ * Does nothing when stats is null.
+ */
+class StageTimer {
+public:
+    StageTimer(ConversionStats* stats, ConversionStats::Stage stage);
+    ~StageTimer();
+
+    /**
+     * Book the time so far and stop timing (the destructor then does nothing)
+     */
+    void stop();
+
+private:
+    StageTimer(const StageTimer&);
+    StageTimer& operator=(const StageTimer&);
+
+    ConversionStats* stats_;
+    ConversionStats::Stage stage_;
+    double start_;
+    double booked_;
+};
+
+/**
+ * Output sink that times and counts what passes through to another sink
+ * Writes, flushes and closes count as STAGE_WRITE. Records are counted
+ * as the lines written, including those formatted in place via direct().
+ * Positional writes from worker threads are counted but not timed, as
+ * they overlap formatting.
+ */
+class StatsSink : public OutputSink {
+public:
+    StatsSink(std::unique_ptr<OutputSink> target, ConversionStats& stats);
+
+    void write(const char* data, size_t size) override;
+    void flush() override;
+    void reserve(uint64_t size) override;
+    bool positional() const override { return target_->positional(); }
+    void write_at(uint64_t offset, const char* data, size_t size) override;
+    void advance(uint64_t size) override;
+    char* direct(uint64_t size) override;
+    void close() override;
+
+private:
+    std::unique_ptr<OutputSink> target_;
+    ConversionStats& stats_;
+    char* direct_;
+};
+
+/**
+ * Input source that books the time spent reading to STAGE_READ
+ */
+class StatsInputSource : public InputSource {
+public:
+    StatsInputSource(InputSource& source, ConversionStats& stats)
+        : source_(source), stats_(stats) {}
+
+    size_t read(uint8_t* buffer, size_t size) override;
+
+private:
+    InputSource& source_;
+    ConversionStats& stats_;
+};
+
+/**
+ * Peak resident set size of the process in bytes (0 if unknown)
+ */
+uint64_t peak_rss_bytes();
+
+#endif // STATS_HPP
@@ -0,0 +1,491 @@
+/**
+ * benchmark - Throughput benchmark for the converters, parsers and checksums
+ *
+ * Generates synthetic images of several sizes and fill patterns and times
+ * the hot paths on them: IntelHexConverter and SRecordConverter across
+ * line lengths, address widths and thread counts, the CRC and sum
+ * routines, and the Intel HEX and S-Record parsers.
+ *
+ * Output is CSV on stdout, one line per case, so runs can be diffed or
+ * plotted to spot regressions:
+ *   case,pattern,bytes,line,width,threads,seconds,mb_per_s,records_per_s,allocs_per_mb
+ * Throughput counts binary bytes (1 MB = 10^6 bytes); seconds is the best
+ * of the repetitions. Allocations are counted through the global operator
+ * new and averaged over all repetitions.
+ *
+ * --selftest instead checks the CRC routines against known answers and a
+ * bit-at-a-time reference, so the table and hardware paths stay honest.
+ *
+ * License: BSD-style (same as original hex2bin)
+ */
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <new>
+#include <random>
+#include "HexConverter.hpp"
+#include "SRecordConverter.hpp"
+#include "HexParser.hpp"
+#include "SRecordParser.hpp"
+#include "BinaryUtils.hpp"
+#include "MemoryImage.hpp"
+#include "OutputSink.hpp"
+#include "Parallel.hpp"
+
+#define PROGRAM_NAME "benchmark"
+#define VERSION_STRING "1.0"
+
+// Every allocation in the process goes through here, so the count covers
+// the library's internal buffers as well as its outputs
+static std::atomic<uint64_t> allocation_count(0);
+
+// Kept out of line: GCC otherwise pairs the inlined free() with the
+// new-expression and warns about a mismatched deallocation
+#ifdef __GNUC__
+#define BENCHMARK_NOINLINE __attribute__((noinline))
+#else
+#define BENCHMARK_NOINLINE
+#endif
+
+void* operator new(size_t size) {
+    ++allocation_count;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+BENCHMARK_NOINLINE void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+BENCHMARK_NOINLINE void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+struct ProgramOptions {
+    std::vector<size_t> sizes = { 1 << 20, 16 << 20, 64 << 20 };
+    unsigned repetitions = 3;
+    unsigned thread_count = Parallel::hardware_threads();
+    bool help = false;
+    bool selftest = false;
+};
+
+/**
+ * Result of timing one case
+ */
+struct Measurement {
+    double seconds;
+    uint64_t records;
+    double allocations;
+};
+
+void show_usage(const char* program_name) {
+    std::cerr << "Usage: " << program_name << " [options]\n\n";
+    std::cerr << "Benchmark the converters, parsers and checksums on synthetic images\n\n";
+    std::cerr << "Options:\n";
+    std::cerr << "  -s MB[,MB...] Image sizes in MiB (default: 1,16,64)\n";
+    std::cerr << "  -r COUNT      Repetitions per case, best time wins (default: 3)\n";
+    std::cerr << "  -j THREADS    Thread count for the parallel cases (default: all cores)\n";
+    std::cerr << "  -q            Quick run: 1 and 4 MiB images, one repetition\n";
+    std::cerr << "  --selftest    Check the CRC routines against known answers and exit\n";
+    std::cerr << "  -h, --help    Show this help message\n\n";
+    std::cerr << "Results are written to stdout as CSV.\n";
+}
+
+bool parse_sizes(const std::string& list, std::vector<size_t>& sizes) {
+    sizes.clear();
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        std::string item = list.substr(start, comma == std::string::npos ? std::string::npos
+                                                                         : comma - start);
+        int megabytes = std::atoi(item.c_str());
+        if (megabytes < 1 || megabytes > 4095) {
+            return false;
+        }
+        sizes.push_back(static_cast<size_t>(megabytes) << 20);
+        if (comma == std::string::npos) {
+            break;
+        }
+        start = comma + 1;
+    }
+    return !sizes.empty();
+}
+
+bool parse_arguments(int argc, char* argv[], ProgramOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "-h" || arg == "--help") {
+            options.help = true;
+            return true;
+        } else if (arg == "-s" && i + 1 < argc) {
+            if (!parse_sizes(argv[++i], options.sizes)) {
+                std::cerr << "Error: Invalid size list: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "-r" && i + 1 < argc) {
+            int count = std::atoi(argv[++i]);
+            if (count < 1) {
+                std::cerr << "Error: Invalid repetition count: " << argv[i] << std::endl;
+                return false;
+            }
+            options.repetitions = static_cast<unsigned>(count);
+        } else if (arg == "-j" && i + 1 < argc) {
+            int threads = std::atoi(argv[++i]);
+            if (threads < 1 || threads > 1024) {
+                std::cerr << "Error: Invalid thread count. Must be 1-1024." << std::endl;
+                return false;
+            }
+            options.thread_count = static_cast<unsigned>(threads);
+        } else if (arg == "-q") {
+            options.sizes = { 1 << 20, 4 << 20 };
+            options.repetitions = 1;
+        } else if (arg == "--selftest") {
+            options.selftest = true;
+        } else {
+            std::cerr << "Error: Unknown option: " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Synthetic image: "random" (incompressible), "blank" (all 0xFF, like
+ * erased flash) or "sparse" (4 KiB random blocks among 70% blank ones)
+ */
+std::vector<uint8_t> make_image(size_t size, const std::string& pattern) {
+    std::vector<uint8_t> image(size, 0xFF);
+    if (pattern == "blank") {
+        return image;
+    }
+
+    std::mt19937 random(12345);
+    const size_t block = 4096;
+    for (size_t offset = 0; offset < size; offset += block) {
+        if (pattern == "sparse" && random() % 10 < 7) {
+            continue;
+        }
+        size_t end = std::min(size, offset + block);
+        for (size_t i = offset; i < end; ++i) {
+            image[i] = static_cast<uint8_t>(random());
+        }
+    }
+    return image;
+}
+
+/**
+ * Run task repetitions times; the best time and the average allocation
+ * count are kept, the record count comes from the last run
+ */
+Measurement measure(unsigned repetitions, const std::function<uint64_t()>& task) {
+    Measurement result = { 0.0, 0, 0.0 };
+    uint64_t allocations_before = allocation_count;
+    for (unsigned i = 0; i < repetitions; ++i) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        result.records = task();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (i == 0 || elapsed.count() < result.seconds) {
+            result.seconds = elapsed.count();
+        }
+    }
+    result.allocations = static_cast<double>(allocation_count - allocations_before) / repetitions;
+    return result;
+}
+
+void report(const std::string& name, const std::string& pattern, size_t bytes,
+            size_t line, int width, unsigned threads, const Measurement& m) {
+    double seconds = std::max(m.seconds, 1e-9);
+    std::cout << name << ',' << pattern << ',' << bytes << ',' << line << ','
+              << width << ',' << threads << ','
+              << std::fixed << std::setprecision(6) << m.seconds << ','
+              << std::setprecision(1) << (bytes / seconds / 1e6) << ','
+              << std::setprecision(0) << (m.records / seconds) << ','
+              << std::setprecision(2) << (m.allocations / (bytes / 1e6)) << '\n'
+              << std::defaultfloat << std::flush;
+}
+
+uint64_t count_lines(const std::string& text) {
+    return static_cast<uint64_t>(std::count(text.begin(), text.end(), '\n'));
+}
+
+/**
+ * A CRC variant the library must reproduce
+ * 32-bit results get the library's final XOR with 0xFFFFFFFF, 16-bit none.
+ */
+struct CrcVariant {
+    const char* name;
+    int width;
+    uint32_t polynomial;        // Normal (MSB-first) form
+    uint32_t initial;
+    bool reflected;
+    uint32_t check;             // CRC of "123456789"
+    uint32_t check_pattern;     // CRC of the 1037-byte selftest pattern
+};
+
+/**
+ * Bit-at-a-time CRC, the reference the table and hardware paths must match
+ */
+uint32_t reference_crc(const CrcVariant& variant, const uint8_t* data, size_t size) {
+    const uint32_t top_bit = 1u << (variant.width - 1);
+    const uint32_t mask = top_bit | (top_bit - 1);
+    uint32_t reversed = 0;
+    for (int bit = 0; bit < variant.width; ++bit) {
+        if (variant.polynomial & (1u << bit)) {
+            reversed |= top_bit >> bit;
+        }
+    }
+
+    uint32_t crc = variant.initial;
+    for (size_t i = 0; i < size; ++i) {
+        if (variant.reflected) {
+            crc ^= data[i];
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? (crc >> 1) ^ reversed : crc >> 1;
+            }
+        } else {
+            crc ^= static_cast<uint32_t>(data[i]) << (variant.width - 8);
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = ((crc & top_bit) ? (crc << 1) ^ variant.polynomial : crc << 1) & mask;
+            }
+        }
+    }
+    return variant.width == 32 ? crc ^ 0xFFFFFFFF : crc;
+}
+
+/**
+ * CRC through the library: the slicing-by-8 table engine, or the
+ * calculate_crc entry point, which picks clmul or SSE4.2 where it can
+ */
+uint32_t library_crc(const CrcVariant& variant, bool table, const uint8_t* data, size_t size) {
+    if (variant.width == 16) {
+        uint16_t polynomial = static_cast<uint16_t>(variant.polynomial);
+        uint16_t initial = static_cast<uint16_t>(variant.initial);
+        return table ? BinaryUtils::Crc16Engine::get(polynomial, variant.reflected)
+                           .update(initial, data, size)
+                     : BinaryUtils::calculate_crc16(data, size, polynomial, initial,
+                                                    variant.reflected);
+    }
+    return table ? BinaryUtils::Crc32Engine::get(variant.polynomial, variant.reflected)
+                       .update(variant.initial, data, size) ^ 0xFFFFFFFF
+                 : BinaryUtils::calculate_crc32(data, size, variant.polynomial,
+                                                variant.initial, variant.reflected);
+}
+
+/**
+ * Check every CRC variant on both library paths: the fixed known answers,
+ * then every size up to 320 bytes (either side of the 64-byte clmul
+ * threshold, from an unaligned start) against reference_crc()
+ * @return Process exit code
+ */
+int run_selftest() {
+    static const CrcVariant variants[] = {
+        { "crc32",        32, 0x04C11DB7, 0xFFFFFFFF, false, 0xFC891918, 0x2435DD05 },
+        { "crc32/zlib",   32, 0x04C11DB7, 0xFFFFFFFF, true,  0xCBF43926, 0x8F073FE5 },
+        { "crc32c",       32, 0x1EDC6F41, 0xFFFFFFFF, true,  0xE3069283, 0x44DF09D5 },
+        { "crc16",        16, 0x8005,     0x0000,     false, 0xFEE8,     0x7C07 },
+        { "crc16/arc",    16, 0x8005,     0x0000,     true,  0xBB3D,     0x0909 }
+    };
+    static const char check_text[] = "123456789";
+
+    // Bytes 0..255 four times over, then 0..12
+    uint8_t pattern[1037];
+    for (size_t i = 0; i < sizeof(pattern); ++i) {
+        pattern[i] = static_cast<uint8_t>(i);
+    }
+
+    unsigned checks = 0;
+    unsigned failures = 0;
+    for (const CrcVariant& variant : variants) {
+        for (int table = 0; table < 2; ++table) {
+            const char* path = table ? "table" : "dispatch";
+            struct { const uint8_t* data; size_t size; uint32_t expected; } cases[] = {
+                { reinterpret_cast<const uint8_t*>(check_text), 9, variant.check },
+                { pattern, sizeof(pattern), variant.check_pattern }
+            };
+            for (const auto& c : cases) {
+                uint32_t crc = library_crc(variant, table != 0, c.data, c.size);
+                ++checks;
+                if (crc != c.expected) {
+                    std::cerr << "FAIL " << variant.name << ' ' << path << ' ' << c.size
+                              << " bytes: " << std::hex << crc << " != " << c.expected
+                              << std::dec << std::endl;
+                    ++failures;
+                }
+            }
+            for (size_t size = 0; size <= 320; ++size) {
+                uint32_t crc = library_crc(variant, table != 0, pattern + 1, size);
+                uint32_t expected = reference_crc(variant, pattern + 1, size);
+                ++checks;
+                if (crc != expected) {
+                    std::cerr << "FAIL " << variant.name << ' ' << path << ' ' << size
+                              << " bytes: " << std::hex << crc << " != " << expected
+                              << std::dec << std::endl;
+                    ++failures;
+                }
+            }
+        }
+    }
+
+    std::cout << PROGRAM_NAME << ": " << checks - failures << " of " << checks
+              << " CRC checks passed" << std::endl;
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+    ProgramOptions options;
+    if (!parse_arguments(argc, argv, options)) {
+        return 1;
+    }
+    if (options.help) {
+        show_usage(argv[0]);
+        return 0;
+    }
+    if (options.selftest) {
+        return run_selftest();
+    }
+
+    const uint32_t base_address = 0x08000000;
+    std::vector<unsigned> thread_counts = { 1 };
+    if (options.thread_count > 1) {
+        thread_counts.push_back(options.thread_count);
+    }
+    const char* patterns[] = { "random", "sparse", "blank" };
+
+    std::cout << "case,pattern,bytes,line,width,threads,seconds,mb_per_s,records_per_s,allocs_per_mb\n";
+
+    try {
+        for (size_t size : options.sizes) {
+            for (const char* pattern : patterns) {
+                std::cerr << PROGRAM_NAME << ": " << (size >> 20) << " MiB " << pattern << std::endl;
+                const std::vector<uint8_t> image = make_image(size, pattern);
+                // Line lengths only matter for incompressible data
+                bool full = (std::string(pattern) == "random");
+                std::vector<size_t> hex_lines = full ? std::vector<size_t>{ 16, 32, 255 }
+                                                     : std::vector<size_t>{ 32 };
+                std::vector<size_t> srec_lines = full ? std::vector<size_t>{ 16, 32, 252 }
+                                                      : std::vector<size_t>{ 32 };
+                std::vector<int> srec_widths = full ? std::vector<int>{ 16, 24, 32 }
+                                                    : std::vector<int>{ 32 };
+
+                // Encoders, into an exactly reserved in-memory sink
+                std::string hex_text;
+                for (size_t line : hex_lines) {
+                    for (unsigned threads : thread_counts) {
+                        IntelHexConverter converter(line);
+                        converter.set_thread_count(threads);
+                        Measurement m = measure(options.repetitions, [&]() -> uint64_t {
+                            MemorySink sink;
+                            if (!converter.convert_to_hex(image.data(), image.size(),
+                                                          base_address, sink)) {
+                                throw std::runtime_error(converter.get_last_error());
+                            }
+                            hex_text = sink.release();
+                            return count_lines(hex_text);
+                        });
+                        report("hex_encode", pattern, size, line, 32, threads, m);
+                    }
+                }
+
+                std::string srec_text;
+                for (size_t line : srec_lines) {
+                    for (int width : srec_widths) {
+                        for (unsigned threads : thread_counts) {
+                            SRecordConverter converter(line);
+                            converter.set_thread_count(threads);
+                            Measurement m = measure(options.repetitions, [&]() -> uint64_t {
+                                MemorySink sink;
+                                if (!converter.convert_to_srec(image.data(), image.size(),
+                                                               base_address, sink, width)) {
+                                    throw std::runtime_error(converter.get_last_error());
+                                }
+                                srec_text = sink.release();
+                                return count_lines(srec_text);
+                            });
+                            report("srec_encode", pattern, size, line, width, threads, m);
+                        }
+                    }
+                }
+
+                // Parsers, on text with 32-byte records
+                {
+                    IntelHexConverter converter(32);
+                    MemorySink sink;
+                    converter.convert_to_hex(image.data(), image.size(), base_address, sink);
+                    hex_text = sink.release();
+                }
+                Measurement hex_parse = measure(options.repetitions, [&]() -> uint64_t {
+                    IntelHexParser parser;
+                    MemoryImage parsed;
+                    if (!parser.parse(hex_text.data(), hex_text.size(), parsed)) {
+                        throw std::runtime_error(parser.get_last_error());
+                    }
+                    return parser.get_record_count();
+                });
+                report("hex_parse", pattern, size, 32, 32, 1, hex_parse);
+
+                {
+                    SRecordConverter converter(32);
+                    MemorySink sink;
+                    converter.convert_to_srec(image.data(), image.size(), base_address, sink);
+                    srec_text = sink.release();
+                }
+                Measurement srec_parse = measure(options.repetitions, [&]() -> uint64_t {
+                    SRecordParser parser;
+                    MemoryImage parsed;
+                    if (!parser.parse(srec_text.data(), srec_text.size(), parsed)) {
+                        throw std::runtime_error(parser.get_last_error());
+                    }
+                    return parser.get_record_count();
+                });
+                report("srec_parse", pattern, size, 32, 32, 1, srec_parse);
+
+                // Checksums; the result is folded in so the call is not dropped
+                volatile uint32_t sink_value = 0;
+                Measurement sum8 = measure(options.repetitions, [&]() -> uint64_t {
+                    sink_value = sink_value + BinaryUtils::calculate_checksum8(image.data(), image.size());
+                    return 0;
+                });
+                report("sum8", pattern, size, 0, 8, 1, sum8);
+                Measurement crc16 = measure(options.repetitions, [&]() -> uint64_t {
+                    sink_value = sink_value + BinaryUtils::calculate_crc16(image.data(), image.size());
+                    return 0;
+                });
+                report("crc16", pattern, size, 0, 16, 1, crc16);
+                Measurement crc32 = measure(options.repetitions, [&]() -> uint64_t {
+                    sink_value = sink_value + BinaryUtils::calculate_crc32(image.data(), image.size());
+                    return 0;
+                });
+                report("crc32", pattern, size, 0, 32, 1, crc32);
+
+                // Fill-run scan as --skip-fill runs it: 0xFF runs of 16 or more
+                Measurement fill_scan = measure(options.repetitions, [&]() -> uint64_t {
+                    MemoryImage filled;
+                    filled.add_view_skip_fill(base_address, image.data(), image.size(), 0xFF, 16);
+                    return filled.segments().size();
+                });
+                report("fill_scan", pattern, size, 0, 8, 1, fill_scan);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
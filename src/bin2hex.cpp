@@ -28,18 +28,43 @@
 #include <cstdlib>
 #include <algorithm>
 #include <iomanip>
+#include <memory>
+#include <stdexcept>
 #include "HexConverter.hpp"
+#include "BatchRunner.hpp"
 #include "BinaryUtils.hpp"
+#include "InputSource.hpp"
+#include "InputSpec.hpp"
+#include "MemoryImage.hpp"
+#include "Parallel.hpp"
+#include "Stats.hpp"
 
 #define PROGRAM_NAME "bin2hex"
 #define VERSION_STRING "1.0"
 
 struct ProgramOptions {
     std::string input_file;
+    std::vector<InputFile> inputs;
     std::string output_file;
     uint32_t start_address = 0;
     size_t bytes_per_line = 32;
     bool use_extended_addressing = true;
+    bool memory_map = false;
+    bool mapped_output = false;
+    bool incremental = false;
+    bool stats = false;
+    bool stats_json = false;
+    unsigned thread_count = 1;
+    bool thread_count_set = false;
+    bool batch = false;
+    std::string manifest;
+    bool skip_fill = false;
+    uint8_t fill_byte = 0xFF;
+    size_t skip_min_run = 16;
+    bool embed_checksum = false;
+    bool checksum_range_set = false;
+    bool checksum_address_set = false;
+    BinaryUtils::ChecksumSpec checksum = { BinaryUtils::CHECKSUM_CRC32, 0, 0, 0, false };
     bool verbose = false;
     bool version_info = false;
     bool help = false;
@@ -47,21 +72,42 @@ struct ProgramOptions {
 };
 
 void show_usage(const char* program_name) {
-    std::cout << "Usage: " << program_name << " [options] input_file\n\n";
+    std::cout << "Usage: " << program_name << " [options] input_file[@address] ...\n\n";
     std::cout << "Convert binary files to Intel HEX format\n\n";
+    std::cout << "Several FILE@ADDRESS inputs are merged into one output; plain\n";
+    std::cout << "FILE inputs are placed at the -a address.\n\n";
     std::cout << "Options:\n";
     std::cout << "  -o FILE       Output file (default: input with .hex extension)\n";
     std::cout << "  -a ADDRESS    Starting address in hex (default: 0x0000)\n";
     std::cout << "  -l LENGTH     Bytes per line (1-255, default: 32)\n";
     std::cout << "  -e EXTENSION  Output file extension (default: hex)\n";
     std::cout << "  -s            Use segmented addressing (disable extended addressing)\n";
+    std::cout << "  -m            Memory-map the input file instead of streaming it\n";
+    std::cout << "  -j THREADS    Format records on THREADS threads (0: all cores, implies -m)\n";
+    std::cout << "  -b, --batch   Convert each input to its own output file on -j workers\n";
+    std::cout << "                (default: all cores)\n";
+    std::cout << "  --manifest FILE         Batch-convert \"input[@address] [output]\" lines from FILE\n";
+    std::cout << "  --skip-fill BYTE        Omit runs of BYTE from the output (implies -m)\n";
+    std::cout << "  --skip-min N            Shortest run --skip-fill omits (default: 16)\n";
+    std::cout << "  --mmap-output           Format records straight into a mapping of the output file\n";
+    std::cout << "  --incremental           Re-encode only the 64KB blocks changed since the last run,\n";
+    std::cout << "                          tracked in OUTPUT.idx (implies -m)\n";
+    std::cout << "  --stats[=json]          Report per-stage times, throughput and peak memory on stderr\n";
+    std::cout << "  --checksum TYPE         Embed a sum8, crc16 or crc32 checksum (implies -m)\n";
+    std::cout << "  --checksum-range S:E    Inclusive address range to checksum (default: the\n";
+    std::cout << "                          whole image but the checksum itself)\n";
+    std::cout << "  --checksum-at ADDRESS   Address the checksum is stored at\n";
+    std::cout << "  --checksum-endian ORDER Byte order of the stored checksum: little or big\n";
     std::cout << "  -v            Verbose output\n";
     std::cout << "  -V            Show version information\n";
     std::cout << "  -h, --help    Show this help message\n\n";
     std::cout << "Examples:\n";
     std::cout << "  " << program_name << " firmware.bin\n";
     std::cout << "  " << program_name << " -a 0x8000 -l 16 bootloader.bin\n";
-    std::cout << "  " << program_name << " -o output.hex program.bin\n\n";
+    std::cout << "  " << program_name << " -o output.hex program.bin\n";
+    std::cout << "  " << program_name << " -j 8 large_image.bin\n";
+    std::cout << "  " << program_name << " -o combined.hex boot.bin@0x8000000 app.bin@0x8004000\n";
+    std::cout << "  " << program_name << " --batch -j 8 variants/*.bin\n\n";
 }
 
 void show_version() {
@@ -72,28 +118,41 @@ void show_version() {
     std::cout << "This is free software; see the source for copying conditions.\n";
 }
 
-bool parse_hex_value(const std::string& str, uint32_t& value) {
-    try {
-        size_t pos;
-        if (str.substr(0, 2) == "0x" || str.substr(0, 2) == "0X") {
-            value = std::stoul(str.substr(2), &pos, 16);
-        } else {
-            value = std::stoul(str, &pos, 16);
-        }
-        return pos == str.length() - (str.substr(0, 2) == "0x" || str.substr(0, 2) == "0X" ? 2 : 0);
-    } catch (const std::exception&) {
-        return false;
+/**
+ * Convert every batch input to its own output file
+ * @return Process exit code
+ */
+int run_batch(const ProgramOptions& options) {
+    if (!options.output_file.empty()) {
+        std::cerr << "Error: -o cannot be used in batch mode; name outputs in a manifest.\n";
+        return 1;
     }
-}
 
-std::string get_base_filename(const std::string& path) {
-    size_t last_slash = path.find_last_of("/\\");
-    size_t start = (last_slash == std::string::npos) ? 0 : last_slash + 1;
-    
-    size_t last_dot = path.find_last_of('.');
-    size_t end = (last_dot == std::string::npos || last_dot < start) ? path.length() : last_dot;
-    
-    return path.substr(start, end - start);
+    BatchSettings settings;
+    settings.inputs = options.inputs;
+    settings.manifest = options.manifest;
+    settings.extension = options.extension;
+    settings.start_address = options.start_address;
+    settings.threads = options.thread_count_set ? options.thread_count : Parallel::hardware_threads();
+    settings.verbose = options.verbose;
+    settings.skip_fill = options.skip_fill;
+    settings.fill_byte = options.fill_byte;
+    settings.skip_min_run = options.skip_min_run;
+    settings.embed_checksum = options.embed_checksum;
+    settings.checksum_range_set = options.checksum_range_set;
+    settings.checksum = options.checksum;
+
+    IntelHexConverter prototype(options.bytes_per_line);
+    prototype.set_mapped_output(options.mapped_output);
+    return run_batch(settings, prototype,
+                     [&](IntelHexConverter& converter, const BatchInput& input,
+                         const std::string& output_file) {
+        return input.image ? converter.convert_to_hex(*input.image, output_file,
+                                                      options.use_extended_addressing)
+                           : converter.convert_to_hex(input.data, input.size, input.address,
+                                                      output_file,
+                                                      options.use_extended_addressing);
+    });
 }
 
 bool parse_arguments(int argc, char* argv[], ProgramOptions& options) {
@@ -110,6 +169,15 @@ bool parse_arguments(int argc, char* argv[], ProgramOptions& options) {
             options.verbose = true;
         } else if (arg == "-s") {
             options.use_extended_addressing = false;
+        } else if (arg == "-m") {
+            options.memory_map = true;
+        } else if (arg == "--mmap-output") {
+            options.mapped_output = true;
+        } else if (arg == "--incremental") {
+            options.incremental = true;
+        } else if (arg == "--stats" || arg == "--stats=json") {
+            options.stats = true;
+            options.stats_json = (arg == "--stats=json");
         } else if (arg == "-o" && i + 1 < argc) {
             options.output_file = argv[++i];
         } else if (arg == "-a" && i + 1 < argc) {
@@ -124,49 +192,78 @@ bool parse_arguments(int argc, char* argv[], ProgramOptions& options) {
                 return false;
             }
             options.bytes_per_line = static_cast<size_t>(length);
+        } else if (arg == "-j" && i + 1 < argc) {
+            int threads = std::atoi(argv[++i]);
+            if (threads < 0 || threads > 1024) {
+                std::cerr << "Error: Invalid thread count. Must be 0-1024." << std::endl;
+                return false;
+            }
+            options.thread_count = threads > 0 ? static_cast<unsigned>(threads)
+                                               : Parallel::hardware_threads();
+            options.thread_count_set = true;
+        } else if (arg == "-b" || arg == "--batch") {
+            options.batch = true;
+        } else if (arg == "--manifest" && i + 1 < argc) {
+            options.manifest = argv[++i];
+            options.batch = true;
+        } else if (arg == "--skip-fill" && i + 1 < argc) {
+            uint32_t fill;
+            if (!parse_hex_value(argv[++i], fill) || fill > 0xFF) {
+                std::cerr << "Error: Invalid fill byte: " << argv[i] << std::endl;
+                return false;
+            }
+            options.fill_byte = static_cast<uint8_t>(fill);
+            options.skip_fill = true;
+        } else if (arg == "--skip-min" && i + 1 < argc) {
+            int length = std::atoi(argv[++i]);
+            if (length < 1) {
+                std::cerr << "Error: Invalid run length. Must be at least 1." << std::endl;
+                return false;
+            }
+            options.skip_min_run = static_cast<size_t>(length);
+        } else if (arg == "--checksum" && i + 1 < argc) {
+            if (!BinaryUtils::parse_checksum_type(argv[++i], options.checksum.type)) {
+                std::cerr << "Error: Invalid checksum type: " << argv[i] << std::endl;
+                return false;
+            }
+            options.embed_checksum = true;
+        } else if (arg == "--checksum-range" && i + 1 < argc) {
+            std::string range = argv[++i];
+            size_t colon = range.find(':');
+            if (colon == std::string::npos ||
+                !parse_hex_value(range.substr(0, colon), options.checksum.range_start) ||
+                !parse_hex_value(range.substr(colon + 1), options.checksum.range_end)) {
+                std::cerr << "Error: Invalid checksum range: " << range << std::endl;
+                return false;
+            }
+            options.checksum_range_set = true;
+        } else if (arg == "--checksum-at" && i + 1 < argc) {
+            if (!parse_hex_value(argv[++i], options.checksum.store_address)) {
+                std::cerr << "Error: Invalid address format: " << argv[i] << std::endl;
+                return false;
+            }
+            options.checksum_address_set = true;
+        } else if (arg == "--checksum-endian" && i + 1 < argc) {
+            std::string order = argv[++i];
+            if (order != "little" && order != "big") {
+                std::cerr << "Error: Invalid checksum byte order. Must be little or big." << std::endl;
+                return false;
+            }
+            options.checksum.big_endian = (order == "big");
         } else if (arg == "-e" && i + 1 < argc) {
             options.extension = argv[++i];
         } else if (arg.front() == '-') {
             std::cerr << "Error: Unknown option: " << arg << std::endl;
             return false;
         } else {
-            // Assume it's the input file
-            if (options.input_file.empty()) {
-                options.input_file = arg;
-            } else {
-                std::cerr << "Error: Multiple input files specified." << std::endl;
-                return false;
-            }
+            // Assume it's an input file, optionally with its own address
+            options.inputs.push_back(parse_input_spec(arg));
         }
     }
     
     return true;
 }
 
-std::vector<uint8_t> read_binary_file(const std::string& filename) {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot open input file: " + filename);
-    }
-    
-    // Get file size
-    file.seekg(0, std::ios::end);
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
-    
-    if (size < 0) {
-        throw std::runtime_error("Cannot determine file size: " + filename);
-    }
-    
-    // Read entire file
-    std::vector<uint8_t> buffer(static_cast<size_t>(size));
-    if (!file.read(reinterpret_cast<char*>(buffer.data()), size)) {
-        throw std::runtime_error("Error reading file: " + filename);
-    }
-    
-    return buffer;
-}
-
 int main(int argc, char* argv[]) {
     ProgramOptions options;
     
@@ -192,12 +289,61 @@ int main(int argc, char* argv[]) {
         return 0;
     }
     
-    if (options.input_file.empty()) {
+    if (options.embed_checksum && !options.checksum_address_set) {
+        std::cerr << "Error: --checksum requires --checksum-at.\n";
+        return 1;
+    }
+    
+    if (options.batch && options.stats) {
+        std::cerr << "Error: --stats works on a single conversion only.\n";
+        return 1;
+    }
+    
+    if (options.batch && options.incremental) {
+        std::cerr << "Error: --incremental works on a single conversion only.\n";
+        return 1;
+    }
+    
+    if (options.batch) {
+        return run_batch(options);
+    }
+    
+    if (options.inputs.empty()) {
         std::cerr << "Error: No input file specified.\n";
         show_usage(argv[0]);
         return 1;
     }
     
+    // A single input's own address is just the start address; several
+    // inputs are merged, plain ones going at the start address
+    options.input_file = options.inputs[0].filename;
+    bool merge = options.inputs.size() > 1;
+    for (size_t i = 0; i < options.inputs.size(); ++i) {
+        if (!options.inputs[i].address_set) {
+            options.inputs[i].address = options.start_address;
+        }
+    }
+    if (!merge) {
+        options.start_address = options.inputs[0].address;
+    }
+    
+    if (merge && options.embed_checksum) {
+        std::cerr << "Error: --checksum works on a single input only.\n";
+        return 1;
+    }
+    
+    if (options.incremental && (merge || options.skip_fill)) {
+        std::cerr << "Error: --incremental works on a single input without --skip-fill.\n";
+        return 1;
+    }
+    
+    // Parallel formatting, fill skipping, checksum patching and block
+    // hashing need the whole input in memory
+    if (options.thread_count > 1 || options.skip_fill || options.embed_checksum || merge ||
+        options.incremental) {
+        options.memory_map = true;
+    }
+    
     // Generate output filename if not specified
     if (options.output_file.empty()) {
         std::string base = get_base_filename(options.input_file);
@@ -205,35 +351,137 @@ int main(int argc, char* argv[]) {
     }
     
     try {
+        // Stages are only timed when --stats hands out a ConversionStats
+        ConversionStats stats;
+        ConversionStats* stage_stats = options.stats ? &stats : nullptr;
+        double run_start = ConversionStats::now();
+        
         // Read binary file
         if (options.verbose) {
-            std::cout << "Reading binary file: " << options.input_file << std::endl;
+            std::cout << "Reading binary file" << (merge ? "s" : "") << ": " << options.input_file;
+            for (size_t i = 1; i < options.inputs.size(); ++i) {
+                std::cout << ", " << options.inputs[i].filename;
+            }
+            std::cout << std::endl;
+        }
+        
+        // Either map the input read-only or stream it in chunks; merged
+        // inputs stay mapped and become views in a sparse image
+        StageTimer read_timer(stage_stats, ConversionStats::STAGE_READ);
+        std::unique_ptr<MappedFile> mapped;
+        std::unique_ptr<FileInputSource> input;
+        std::vector<std::unique_ptr<MappedFile>> merged_files;
+        MemoryImage image;
+        uint64_t file_size = 0;
+        if (merge) {
+            load_inputs(options.inputs, options.skip_fill, options.fill_byte, options.skip_min_run,
+                        merged_files, image);
+            for (size_t i = 0; i < merged_files.size(); ++i) {
+                file_size += merged_files[i]->size();
+                if (options.verbose && merged_files[i]->size() > 0) {
+                    std::cout << "  " << options.inputs[i].filename << ": 0x" << std::hex << std::uppercase
+                             << std::setfill('0') << std::setw(8) << options.inputs[i].address
+                             << " - 0x" << std::setw(8)
+                             << (options.inputs[i].address + merged_files[i]->size() - 1)
+                             << std::dec << std::endl;
+                }
+            }
+        } else if (options.memory_map) {
+            mapped.reset(new MappedFile(options.input_file, options.embed_checksum));
+            file_size = mapped->size();
+        } else {
+            input.reset(new FileInputSource(options.input_file));
+            file_size = input->size();
         }
+        read_timer.stop();
         
-        std::vector<uint8_t> binary_data = read_binary_file(options.input_file);
+        // Streamed input is timed and counted as the converter reads it
+        InputSource* source = input.get();
+        std::unique_ptr<StatsInputSource> timed_input;
+        if (input && stage_stats) {
+            timed_input.reset(new StatsInputSource(*input, stats));
+            source = timed_input.get();
+        } else {
+            stats.add_input_bytes(file_size);
+        }
         
         if (options.verbose) {
-            std::cout << "File size: " << binary_data.size() << " bytes" << std::endl;
+            std::cout << "File size: " << file_size << " bytes" << std::endl;
             std::cout << "Start address: 0x" << std::hex << std::uppercase 
-                     << std::setfill('0') << std::setw(8) << options.start_address << std::endl;
+                     << std::setfill('0') << std::setw(8)
+                     << (merge ? image.low_address() : options.start_address) << std::endl;
             std::cout << "Bytes per line: " << std::dec << options.bytes_per_line << std::endl;
             std::cout << "Extended addressing: " 
                      << (options.use_extended_addressing ? "enabled" : "disabled") << std::endl;
+            std::cout << "Threads: " << options.thread_count << std::endl;
+            std::cout << "Output: " << (options.mapped_output ? "memory-mapped" : "buffered writes")
+                     << std::endl;
+        }
+        
+        // Patch the checksum into the copy-on-write mapping before encoding
+        if (options.embed_checksum) {
+            StageTimer checksum_timer(stage_stats, ConversionStats::STAGE_CHECKSUM);
+            uint32_t value = options.checksum_range_set
+                ? BinaryUtils::embed_checksum(mapped->mutable_data(), mapped->size(),
+                                              options.start_address, options.checksum)
+                : BinaryUtils::embed_image_checksum(mapped->mutable_data(), mapped->size(),
+                                                    options.start_address, options.checksum);
+            if (options.verbose) {
+                std::cout << "Checksum: 0x" << std::hex << std::uppercase
+                         << std::setfill('0') << std::setw(2 * BinaryUtils::checksum_width(options.checksum.type))
+                         << value << " at 0x" << std::setw(8) << options.checksum.store_address
+                         << std::dec << std::endl;
+            }
         }
         
         // Convert to Intel HEX
         IntelHexConverter converter(options.bytes_per_line);
+        converter.set_thread_count(options.thread_count);
+        converter.set_mapped_output(options.mapped_output);
+        converter.set_stats(stage_stats);
         
         if (options.verbose) {
             std::cout << "Converting to Intel HEX format..." << std::endl;
         }
         
-        bool success = converter.convert_to_hex(
-            binary_data,
-            options.start_address,
-            options.output_file,
-            options.use_extended_addressing
-        );
+        StageTimer encode_timer(stage_stats, ConversionStats::STAGE_ENCODE);
+        bool success;
+        if (merge || options.skip_fill) {
+            // Leave blank regions out of the image so they produce no records
+            if (!merge) {
+                image.add_view_skip_fill(options.start_address, mapped->data(), mapped->size(),
+                                         options.fill_byte, options.skip_min_run);
+            }
+            if (options.verbose && options.skip_fill) {
+                std::cout << "Skipped fill bytes: " << (file_size - image.byte_count())
+                         << " in runs of at least " << options.skip_min_run
+                         << " (" << image.segments().size() << " segments left)" << std::endl;
+            }
+            success = converter.convert_to_hex(image,
+                                               options.output_file,
+                                               options.use_extended_addressing);
+        } else if (options.incremental) {
+            success = converter.convert_to_hex_incremental(mapped->data(), mapped->size(),
+                                                           options.start_address,
+                                                           options.output_file,
+                                                           options.output_file + ".idx",
+                                                           options.use_extended_addressing);
+            if (success && options.verbose) {
+                std::cout << "Re-encoded blocks: " << converter.get_blocks_encoded()
+                         << " of " << converter.get_block_count() << std::endl;
+            }
+        } else if (mapped) {
+            success = converter.convert_to_hex(mapped->data(), mapped->size(),
+                                               options.start_address,
+                                               options.output_file,
+                                               options.use_extended_addressing);
+        } else {
+            success = converter.convert_to_hex(*source,
+                                               options.start_address,
+                                               options.output_file,
+                                               options.use_extended_addressing);
+        }
+        encode_timer.stop();
         
         if (!success) {
             std::cerr << "Error: " << converter.get_last_error() << std::endl;
@@ -244,14 +492,21 @@ int main(int argc, char* argv[]) {
             std::cout << "Successfully wrote: " << options.output_file << std::endl;
             
             // Calculate and show some statistics
-            uint32_t end_address = options.start_address + binary_data.size() - 1;
+            uint32_t low_address = merge ? image.low_address() : options.start_address;
+            uint32_t end_address = merge ? static_cast<uint32_t>(image.high_address() - 1)
+                                         : static_cast<uint32_t>(options.start_address + file_size - 1);
             std::cout << "Address range: 0x" << std::hex << std::uppercase 
-                     << std::setfill('0') << std::setw(8) << options.start_address
+                     << std::setfill('0') << std::setw(8) << low_address
                      << " - 0x" << std::setw(8) << end_address << std::endl;
         } else {
             std::cout << "Output written to: " << options.output_file << std::endl;
         }
         
+        // On stderr, so a JSON report can be captured apart from the banner
+        if (options.stats) {
+            stats.print(std::cerr, options.stats_json, ConversionStats::now() - run_start);
+        }
+        
         return 0;
         
     } catch (const std::exception& e) {
@@ -0,0 +1,197 @@
+/**
+ * mot2bin - Motorola S-Record to binary converter
+ * 
+ * This utility decodes Motorola S-Record files back into flat binary
+ * images. Records are parsed in place from a memory-mapped input into a
+ * sparse memory image, using the same SIMD hex kernels as bin2mot.
+ * 
+ * Features:
+ * - Supports S0-S9 records (S1/S2/S3 data with 16/24/32-bit addresses)
+ * - Verifies every record checksum and the S5/S6 record count
+ * - Gaps between records are filled with a configurable byte
+ * 
+ * License: BSD-style (same as original mot2bin)
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <iomanip>
+#include "SRecordParser.hpp"
+#include "MemoryImage.hpp"
+#include "BinaryUtils.hpp"
+#include "InputSource.hpp"
+#include "InputSpec.hpp"
+
+#define PROGRAM_NAME "mot2bin"
+#define VERSION_STRING "1.0"
+
+struct ProgramOptions {
+    std::string input_file;
+    std::string output_file;
+    uint8_t fill_byte = 0xFF;
+    bool verbose = false;
+    bool version_info = false;
+    bool help = false;
+    std::string extension = "bin";
+};
+
+void show_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options] input_file\n\n";
+    std::cout << "Convert Motorola S-Record files to binary\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  -o FILE       Output file (default: input with .bin extension)\n";
+    std::cout << "  -f BYTE       Fill byte for gaps between records (default: 0xFF)\n";
+    std::cout << "  -e EXTENSION  Output file extension (default: bin)\n";
+    std::cout << "  -v            Verbose output\n";
+    std::cout << "  -V            Show version information\n";
+    std::cout << "  -h, --help    Show this help message\n\n";
+    std::cout << "Examples:\n";
+    std::cout << "  " << program_name << " firmware.s37\n";
+    std::cout << "  " << program_name << " -f 0x00 -o image.bin firmware.s37\n\n";
+}
+
+void show_version() {
+    std::cout << PROGRAM_NAME << " v" << VERSION_STRING << "\n";
+    std::cout << "Motorola S-Record to binary format converter\n";
+    std::cout << "Compatible with mot2bin v2.5 specification\n\n";
+    std::cout << "Copyright (C) 2024 - Binary conversion utilities\n";
+    std::cout << "This is free software; see the source for copying conditions.\n";
+}
+
+bool parse_arguments(int argc, char* argv[], ProgramOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        
+        if (arg == "-h" || arg == "--help") {
+            options.help = true;
+            return true;
+        } else if (arg == "-V") {
+            options.version_info = true;
+            return true;
+        } else if (arg == "-v") {
+            options.verbose = true;
+        } else if (arg == "-o" && i + 1 < argc) {
+            options.output_file = argv[++i];
+        } else if (arg == "-f" && i + 1 < argc) {
+            uint32_t fill;
+            if (!parse_hex_value(argv[++i], fill) || fill > 0xFF) {
+                std::cerr << "Error: Invalid fill byte: " << argv[i] << std::endl;
+                return false;
+            }
+            options.fill_byte = static_cast<uint8_t>(fill);
+        } else if (arg == "-e" && i + 1 < argc) {
+            options.extension = argv[++i];
+        } else if (arg.front() == '-') {
+            std::cerr << "Error: Unknown option: " << arg << std::endl;
+            return false;
+        } else {
+            // Assume it's the input file
+            if (options.input_file.empty()) {
+                options.input_file = arg;
+            } else {
+                std::cerr << "Error: Multiple input files specified." << std::endl;
+                return false;
+            }
+        }
+    }
+    
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    ProgramOptions options;
+    
+    std::cout << PROGRAM_NAME << " v" << VERSION_STRING 
+              << " - Motorola S-Record to binary converter\n\n";
+    
+    if (argc == 1) {
+        show_usage(argv[0]);
+        return 1;
+    }
+    
+    if (!parse_arguments(argc, argv, options)) {
+        return 1;
+    }
+    
+    if (options.help) {
+        show_usage(argv[0]);
+        return 0;
+    }
+    
+    if (options.version_info) {
+        show_version();
+        return 0;
+    }
+    
+    if (options.input_file.empty()) {
+        std::cerr << "Error: No input file specified.\n";
+        show_usage(argv[0]);
+        return 1;
+    }
+    
+    // Generate output filename if not specified
+    if (options.output_file.empty()) {
+        std::string base = get_base_filename(options.input_file);
+        options.output_file = base + "." + options.extension;
+    }
+    
+    try {
+        if (options.verbose) {
+            std::cout << "Reading S-Record file: " << options.input_file << std::endl;
+        }
+        
+        MappedFile mapped(options.input_file);
+        SRecordParser parser;
+        MemoryImage image;
+        if (!parser.parse(reinterpret_cast<const char*>(mapped.data()), mapped.size(), image)) {
+            std::cerr << "Error: " << parser.get_last_error() << std::endl;
+            return 1;
+        }
+        
+        std::ofstream out(options.output_file, std::ios::binary);
+        if (!out.is_open()) {
+            std::cerr << "Error: Failed to open output file: " << options.output_file << std::endl;
+            return 1;
+        }
+        
+        // Flatten the segments, filling the gaps between them
+        image.write_flat(out, options.fill_byte);
+        out.close();
+        if (!out) {
+            std::cerr << "Error: Error writing output file: " << options.output_file << std::endl;
+            return 1;
+        }
+        
+        if (options.verbose) {
+            if (!parser.get_header().empty()) {
+                std::cout << "Header: " << parser.get_header() << std::endl;
+            }
+            std::cout << "Data records: " << parser.get_record_count() << std::endl;
+            std::cout << "Address size: " << parser.get_address_size() << " bits" << std::endl;
+            std::cout << "Segments: " << image.segments().size() << std::endl;
+            std::cout << "Image size: " << (image.high_address() - image.low_address())
+                     << " bytes (" << image.byte_count() << " from records)" << std::endl;
+            if (!image.empty()) {
+                std::cout << "Address range: 0x" << std::hex << std::uppercase 
+                         << std::setfill('0') << std::setw(8) << image.low_address()
+                         << " - 0x" << std::setw(8) << (image.high_address() - 1) << std::endl;
+            }
+            std::cout << "Start address: 0x" << std::hex << std::uppercase
+                     << std::setfill('0') << std::setw(8) << parser.get_start_address() << std::endl;
+            std::cout << std::dec << "Successfully wrote: " << options.output_file << std::endl;
+        } else {
+            std::cout << "Output written to: " << options.output_file << std::endl;
+        }
+        
+        return 0;
+        
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}